@@ -0,0 +1,463 @@
+/******************************************************/
+/* bench.c                                            */
+/* Benchmarks of the integration and pfa functions    */
+/* Creation date: 17 October, 2026                    */
+/*                                                    */
+/* Usage : bench.exe [csv|json] [quick] [trace]       */
+/* One record per measure: function, quadrature,      */
+/* parameter, ns/op, evaluations of the integrand     */
+/* per call (0 if not measured) and absolute error    */
+/* (error vs time: accuracy-vs-cost curves).          */
+/* Built with -DPFA_INSTRUMENT, the evaluations of    */
+/* the pfa functions come from the counters of        */
+/* instrument.h, and trace writes bench_trace.json    */
+/* (one call of each function) and the counters on    */
+/* stderr.                                            */
+/******************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include "integration.h"
+#include "pfa.h"
+#include "instrument.h"
+
+/* Minimal measured time of one record, in seconds */
+static double minTime = 0.2;
+static bool json = false;
+static int records = 0;
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+static void record(char* function, char* quadrature, double parameter, double nsPerOp, double evals, double error)
+{
+  if (json)
+  {
+    printf("%s\n  {\"function\": \"%s\", \"quadrature\": \"%s\", \"parameter\": %.10g, \"ns_per_op\": %.1f, "
+           "\"evals_per_call\": %.0f, \"error\": %.3e}", (records == 0) ? "[" : ",",
+           function, quadrature, parameter, nsPerOp, evals, error);
+  }
+  else
+  {
+    if (records == 0)
+    {
+      printf("function,quadrature,parameter,ns_per_op,evals_per_call,error\n");
+    }
+    printf("%s,%s,%.10g,%.1f,%.0f,%.3e\n", function, quadrature, parameter, nsPerOp, evals, error);
+  }
+  records++;
+}
+
+/* The benchmarked call, run reps times. Returns the value of the last call. */
+typedef double (*Benchmark)(void* data);
+
+/* Repeats the call (doubling the number of repetitions) until it lasts minTime.
+   Returns ns/op, and the value of the call in *value. */
+static double timeIt(Benchmark bench, void* data, double* value)
+{
+  volatile double sink = 0.0;
+  long reps = 1;
+  for (;;)
+  {
+    double start = now();
+    for (long r = 0; r < reps; r++)
+    {
+      sink = bench(data);
+    }
+    double elapsed = now() - start;
+    if (elapsed >= minTime || reps >= (1L << 40))
+    {
+      *value = sink;
+      return 1e9*elapsed/reps;
+    }
+    reps = (elapsed < minTime/16) ? reps*16 : reps*2;
+  }
+}
+
+/* ==========================================================*/
+/* integrate                                                 */
+
+static long evals = 0;
+
+/* sin(x^2) on [-1,4], the example of the specifications, with a counter of evaluations */
+static double f5(double x)
+{
+  evals++;
+  return sin(x*x);
+}
+
+typedef struct{
+  QuadFormula qf;
+  int N;
+} IntegrateData;
+
+static double benchIntegrate(void* data)
+{
+  IntegrateData* d = (IntegrateData*) data;
+  return integrate(f5, -1.0, 4.0, d->N, &d->qf);
+}
+
+static void benchIntegrateRules(bool quick)
+{
+  char* rules[] = {"left", "right", "middle", "trapezes", "simpson", "gauss2", "gauss3", "gauss10", "lobatto5", "clenshaw9"};
+  int nbRules = quick ? 4 : 10;
+  /* Reference: gauss64 with 200 subdivisions */
+  IntegrateData ref;
+  setQuadFormula(&ref.qf, "gauss64");
+  double exact = integrate(f5, -1.0, 4.0, 200, &ref.qf);
+  for (int r = 0; r < nbRules; r++)
+  {
+    for (int N = 10; N <= (quick ? 1000 : 100000); N *= 10)
+    {
+      IntegrateData d;
+      setQuadFormula(&d.qf, rules[r]);
+      d.N = N;
+      double value;
+      double ns = timeIt(benchIntegrate, &d, &value);
+      evals = 0;
+      benchIntegrate(&d);
+      record("integrate", rules[r], N, ns, evals, fabs(value - exact));
+    }
+  }
+}
+
+/* ==========================================================*/
+/* pfa functions                                             */
+
+typedef struct{
+  double x;
+  Option option;
+  InsuredClient client;
+} PfaData;
+
+static double benchPHI(void* data)
+{
+  return PHI(((PfaData*) data)->x);
+}
+
+static double benchOptionPrice(void* data)
+{
+  return optionPrice(&((PfaData*) data)->option);
+}
+
+static double benchCDF_X(void* data)
+{
+  PfaData* d = (PfaData*) data;
+  return clientCDF_X(&d->client, d->x);
+}
+
+static double benchCDF_X1X2(void* data)
+{
+  PfaData* d = (PfaData*) data;
+  return clientCDF_X1X2(&d->client, d->x);
+}
+
+static double benchCDF_S(void* data)
+{
+  PfaData* d = (PfaData*) data;
+  return clientCDF_S(&d->client, d->x);
+}
+
+/* Evaluations of the integrands per call, without the counters of instrument.h: the
+   number of subdivisions of integrate_dx_r and integrate_dx_batch (nbSubdivisions in
+   integration.c) times the 3 nodes of gauss3. m is the index of the PHI method
+   (0: quadrature) or 1 with the severity grid. */
+typedef double (*EvalCount)(PfaData* d, double dt, int m);
+
+static double subdivisions(double a, double b, double dt)
+{
+  double N = round(fabs(b-a)/dt);
+  return (N < 1) ? 1 : N;
+}
+
+static double evalsPHI_at(double x, double dt, int m)
+{
+  return (m == 0) ? 3*subdivisions(0, x, dt) : 0.0;
+}
+
+static double evalsPHI(PfaData* d, double dt, int m)
+{
+  return evalsPHI_at(d->x, dt, m);
+}
+
+/* The two PHI of the call or the put, at sig*sqrt(T) - z0 and -z0 (up to the sign) */
+static double evalsOptionPrice(PfaData* d, double dt, int m)
+{
+  Option* o = &d->option;
+  double sigSqrtT = o->sig*sqrt(o->T);
+  double z0 = (log(o->K/o->S0) - o->T*(o->mu - o->sig*o->sig/2.0))/sigSqrtT;
+  return evalsPHI_at(sigSqrtT - z0, dt, m) + evalsPHI_at(z0, dt, m);
+}
+
+static double evalsCDF_X(PfaData* d, double dt, int m)
+{
+  return (d->x > 0) ? evalsPHI_at((log(d->x) - d->client.m)/d->client.s, dt, m) : 0.0;
+}
+
+/* Distinct offsets c[r] and c[q]-c[r] of the nodes of qf: the rows of the table of
+   gridCDF_X1X2 */
+static int gridOffsets(QuadFormula* qf)
+{
+  double offsets[QUAD_MAX_NODES*(QUAD_MAX_NODES + 1)];
+  int nb = 0;
+  for (int k = 0; k < qf->n*(qf->n + 1); k++)
+  {
+    double offset = (k < qf->n) ? qf->x[k] : qf->x[(k - qf->n)/qf->n] - qf->x[(k - qf->n)%qf->n];
+    int d = 0;
+    while (d < nb && offsets[d] != offset)
+    {
+      d++;
+    }
+    if (d == nb)
+    {
+      offsets[nb++] = offset;
+    }
+  }
+  return nb;
+}
+
+/* Outer integral on [0, x], plus the inner integral on [0, y] at each outer node y;
+   with the grid, the points given to clientPDF_X_batch by gridCDF_X1X2: its table of
+   fX on the N+1 points of each offset, and the 2*n*n points of each last subdivision */
+static double evalsCDF_X1X2(PfaData* d, double dt, int m)
+{
+  if (d->x <= 0)
+  {
+    return 0.0;
+  }
+  double N = subdivisions(0, d->x, dt);
+  QuadFormula qf;
+  setQuadFormula(&qf, "gauss3");
+  if (m == 1)
+  {
+    return gridOffsets(&qf)*(N+1) + 2*N*qf.n*qf.n;
+  }
+  double sub = d->x/N;
+  double total = 3*N;
+  for (long i = 0; i < (long) N; i++)
+  {
+    double ai = i*sub;
+    double bi = (i+1)*sub;
+    for (int j = 0; j < qf.n; j++)
+    {
+      double y = ai + qf.x[j]*(bi - ai);
+      total += (y > 0) ? 3*subdivisions(0, y, dt) : 0.0;
+    }
+  }
+  return total;
+}
+
+/* clientCDF_X with the quadrature method (reset by init_integration) and clientCDF_X1X2 */
+static double evalsCDF_S(PfaData* d, double dt, int m)
+{
+  return evalsCDF_X(d, dt, 0) + evalsCDF_X1X2(d, dt, m);
+}
+
+/* Function f over dt, with quadrature gauss3 (and the three PHI methods for PHI and
+   optionPrice, or with and without the severity grid for clientCDF_X1X2 and clientCDF_S),
+   against the value computed with "adaptive" 1e-12. The evaluations come from the counters
+   of instrument.h when they are compiled in, from evals otherwise. */
+static void benchPfa(char* function, Benchmark f, EvalCount evals, PfaData* d, double* dts, int nbDts, bool phiMethods)
+{
+  char* methods[] = {"quadrature", "erfc", "table"};
+  init_integration("adaptive", 1e-12);
+  double exact = f(d);
+  for (int m = 0; m < (phiMethods ? 3 : 2); m++)
+  {
+    for (int i = 0; i < nbDts; i++)
+    {
+      init_integration("gauss3", dts[i]);
+      if (phiMethods)
+      {
+        init_phi(methods[m]);
+      }
+      else
+      {
+        init_severity_grid(m == 1);
+      }
+      double value;
+      double ns = timeIt(f, d, &value);
+      double calls = evals(d, dts[i], m);
+      if (instrEnabled())
+      {
+        InstrCounters counters;
+        instrReset();
+        f(d);
+        instrThreadCounters(&counters);
+        calls = counters.integrandCalls;
+      }
+      char quadrature[40] = "gauss3";
+      if (phiMethods)
+      {
+        snprintf(quadrature, sizeof(quadrature), "gauss3/%s", methods[m]);
+      }
+      else if (m == 1)
+      {
+        strcpy(quadrature, "gauss3/grid");
+      }
+      record(function, quadrature, dts[i], ns, calls, fabs(value - exact));
+      if (phiMethods && m > 0)
+      {
+        break; /* dt is not used */
+      }
+    }
+  }
+}
+
+/* ==========================================================*/
+/* Double and float batches                                  */
+
+#define BATCH_OPTIONS 65536
+
+typedef struct{
+  OptionBatch batch;
+  OptionBatchf batchf;
+  double* price;
+  float* pricef;
+} PriceBatchData;
+
+static double benchPriceBatch(void* data)
+{
+  PriceBatchData* d = (PriceBatchData*) data;
+  optionPriceBatch(&d->batch, d->price);
+  return d->price[0];
+}
+
+static double benchPriceBatchf(void* data)
+{
+  PriceBatchData* d = (PriceBatchData*) data;
+  optionPriceBatchf(&d->batchf, d->pricef, NULL);
+  return d->pricef[0];
+}
+
+static QuadFormula gauss3;
+
+static void phiBatch(double* x, double* y, size_t n, void* data)
+{
+  (void) data;
+  phi_batch(x, y, n);
+}
+
+static void phiBatchf(float* x, float* y, size_t n, void* data)
+{
+  (void) data;
+  phi_batchf(x, y, n);
+}
+
+static double benchIntegrateBatch(void* data)
+{
+  return integrate_batch(phiBatch, NULL, -5.0, 1.0, *(int*) data, &gauss3);
+}
+
+static double benchIntegrateBatchf(void* data)
+{
+  return integrate_batchf(phiBatchf, NULL, -5.0, 1.0, *(int*) data, &gauss3, NULL);
+}
+
+/* Records per option (parameter: number of options) and per integral of phi on [-5, 1]
+   with gauss3 (parameter: N); the error of the float records is the largest
+   |float - double| / (S0*exp(mu*T) + K) for the options, |float - double| for the integral */
+static void benchPrecision(void)
+{
+  int n = BATCH_OPTIONS;
+  PriceBatchData d;
+  OptionType* type = malloc(n*sizeof(OptionType));
+  double* values = malloc(6*n*sizeof(double));
+  float* valuesf = malloc(6*n*sizeof(float));
+  d.batch = (OptionBatch) {n, type, values, values+n, values+2*n, values+3*n, values+4*n};
+  d.batchf = (OptionBatchf) {n, type, valuesf, valuesf+n, valuesf+2*n, valuesf+3*n, valuesf+4*n};
+  d.price = values+5*n;
+  d.pricef = valuesf+5*n;
+  srand(1);
+  for (int i = 0; i < n; i++)
+  {
+    type[i] = (i % 3 == 0) ? PUT : CALL;
+    d.batchf.S0[i] = 50.0f + 100.0f*rand()/RAND_MAX;
+    d.batchf.K[i] = 50.0f + 100.0f*rand()/RAND_MAX;
+    d.batchf.T[i] = 0.05f + 3.0f*rand()/RAND_MAX;
+    d.batchf.mu[i] = -0.05f + 0.15f*rand()/RAND_MAX;
+    d.batchf.sig[i] = 0.05f + 0.6f*rand()/RAND_MAX;
+  }
+  for (int i = 0; i < 5*n; i++)
+  {
+    values[i] = valuesf[i];
+  }
+  double value;
+  double ns = timeIt(benchPriceBatch, &d, &value);
+  record("optionPriceBatch", "double", n, ns/n, 0, 0.0);
+  ns = timeIt(benchPriceBatchf, &d, &value);
+  double drift = 0.0;
+  for (int i = 0; i < n; i++)
+  {
+    double e = fabs(d.pricef[i] - d.price[i])/(d.batch.S0[i]*exp(d.batch.mu[i]*d.batch.T[i]) + d.batch.K[i]);
+    drift = (e > drift) ? e : drift;
+  }
+  record("optionPriceBatch", "float", n, ns/n, 0, drift);
+  free(type);
+  free(values);
+  free(valuesf);
+
+  int N = 10000;
+  setQuadFormula(&gauss3, "gauss3");
+  double exact = integrate_batch(phiBatch, NULL, -5.0, 1.0, N, &gauss3);
+  ns = timeIt(benchIntegrateBatch, &N, &value);
+  record("integrate_batch", "double", N, ns, 3.0*N, 0.0);
+  ns = timeIt(benchIntegrateBatchf, &N, &value);
+  record("integrate_batch", "float", N, ns, 3.0*N, fabs(value - exact));
+}
+
+int main(int argc, char** argv)
+{
+  bool quick = false, trace = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "json") == 0) json = true;
+    else if (strcmp(argv[i], "quick") == 0) quick = true;
+    else if (strcmp(argv[i], "trace") == 0) trace = true;
+  }
+  if (quick)
+  {
+    minTime = 0.02;
+  }
+
+  benchIntegrateRules(quick);
+
+  double probs[3] = {0.7, 0.25, 0.05};
+  PfaData d = {1.96, {CALL, 100.0, 100.0, 1.0, 0.10, 0.3}, {7.0, 1.5, probs}};
+  double dtsPHI[] = {1.0, 0.1, 0.01, 0.001};
+  benchPfa("PHI", benchPHI, evalsPHI, &d, dtsPHI, quick ? 2 : 4, true);
+  benchPfa("optionPrice", benchOptionPrice, evalsOptionPrice, &d, dtsPHI, quick ? 2 : 4, true);
+  d.x = 5000.0;
+  benchPfa("clientCDF_X", benchCDF_X, evalsCDF_X, &d, dtsPHI, quick ? 2 : 4, true);
+  double dtsX1X2[] = {50.0, 20.0, 10.0, 5.0};
+  d.x = 1000.0;
+  benchPfa("clientCDF_X1X2", benchCDF_X1X2, evalsCDF_X1X2, &d, dtsX1X2, quick ? 2 : 4, false);
+  benchPfa("clientCDF_S", benchCDF_S, evalsCDF_S, &d, dtsX1X2, quick ? 2 : 4, false);
+  benchPrecision();
+
+  if (json)
+  {
+    printf("\n]\n");
+  }
+
+  if (trace && instrEnabled())
+  {
+    init_integration("gauss3", 10.0);
+    instrReset();
+    benchPHI(&d);
+    benchOptionPrice(&d);
+    benchCDF_X(&d);
+    benchCDF_X1X2(&d);
+    benchCDF_S(&d);
+    if (!instrWriteTrace("bench_trace.json"))
+    {
+      fprintf(stderr, "bench_trace.json can not be written\n");
+    }
+    instrWriteSnapshot(stderr);
+  }
+  return 0;
+}
@@ -0,0 +1,232 @@
+#define CLIENTBOOK_C
+
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "clientbook.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+/* Doubles written at once by writeClientBook */
+#define WRITE_BUFFER 4096
+
+static uint64_t updateChecksum(uint64_t h, void* data, size_t n)
+{
+  unsigned char* bytes = (unsigned char*) data;
+  for (size_t i = 0; i + 8 <= n; i += 8)
+  {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    h = (h ^ word)*FNV_PRIME;
+  }
+  return h;
+}
+
+uint64_t clientBookChecksum(void* data, size_t n)
+{
+  return updateChecksum(FNV_OFFSET, data, n);
+}
+
+static uint64_t align64(uint64_t offset)
+{
+  return (offset + 63) & ~(uint64_t) 63;
+}
+
+/* Buffered output of writeClientBook, with the checksum of the bytes written after the header */
+typedef struct{
+  FILE* file;
+  uint64_t checksum;
+  uint64_t offset;
+  double buffer[WRITE_BUFFER];
+  int used;
+  bool failed;
+} BookWriter;
+
+static void flushBuffer(BookWriter* w)
+{
+  if (w->used == 0)
+  {
+    return;
+  }
+  w->checksum = updateChecksum(w->checksum, w->buffer, w->used*sizeof(double));
+  if (fwrite(w->buffer, sizeof(double), w->used, w->file) != (size_t) w->used)
+  {
+    w->failed = true;
+  }
+  w->offset += w->used*sizeof(double);
+  w->used = 0;
+}
+
+static void writeValue(BookWriter* w, double value)
+{
+  w->buffer[w->used++] = value;
+  if (w->used == WRITE_BUFFER)
+  {
+    flushBuffer(w);
+  }
+}
+
+/* Zeros up to offset (multiple of 8) */
+static void padTo(BookWriter* w, uint64_t offset)
+{
+  while (w->offset + w->used*sizeof(double) < offset)
+  {
+    writeValue(w, 0.0);
+  }
+  flushBuffer(w);
+}
+
+bool writeClientBook(char* filename, InsuredClient* clients, long n)
+{
+  if (filename == NULL || n < 0 || (n > 0 && clients == NULL))
+  {
+    return false;
+  }
+  ClientBookHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CLIENTBOOK_MAGIC, sizeof(header.magic));
+  header.version = CLIENTBOOK_VERSION;
+  header.endian = CLIENTBOOK_ENDIAN;
+  header.n = n;
+  header.offsetM = CLIENTBOOK_HEADER;
+  header.offsetS = align64(header.offsetM + n*sizeof(double));
+  header.offsetP = align64(header.offsetS + n*sizeof(double));
+
+  BookWriter* w = malloc(sizeof(BookWriter));
+  if (w == NULL)
+  {
+    return false;
+  }
+  w->file = fopen(filename, "wb");
+  if (w->file == NULL)
+  {
+    free(w);
+    return false;
+  }
+  w->checksum = FNV_OFFSET;
+  w->offset = CLIENTBOOK_HEADER;
+  w->used = 0;
+  /* The header is written again at the end, with the checksum */
+  w->failed = fwrite(&header, sizeof(header), 1, w->file) != 1;
+  for (long i = 0; i < n; i++)
+  {
+    writeValue(w, clients[i].m);
+  }
+  padTo(w, header.offsetS);
+  for (long i = 0; i < n; i++)
+  {
+    writeValue(w, clients[i].s);
+  }
+  padTo(w, header.offsetP);
+  for (long i = 0; i < n; i++)
+  {
+    writeValue(w, clients[i].p[0]);
+    writeValue(w, clients[i].p[1]);
+    writeValue(w, clients[i].p[2]);
+  }
+  flushBuffer(w);
+  header.checksum = w->checksum;
+  if (fseek(w->file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, w->file) != 1)
+  {
+    w->failed = true;
+  }
+  /* Always closed; a partial file is removed (a regular file only: not /dev/full...) */
+  struct stat st;
+  bool regular = fstat(fileno(w->file), &st) == 0 && S_ISREG(st.st_mode);
+  bool ok = !w->failed & (fclose(w->file) == 0);
+  free(w);
+  if (!ok && regular)
+  {
+    unlink(filename);
+  }
+  return ok;
+}
+
+void closeClientBook(ClientBook* book)
+{
+  if (book == NULL)
+  {
+    return;
+  }
+  munmap(book->map, book->mapSize);
+  free(book);
+}
+
+/* true if the header describes a book of exactly size bytes */
+static bool validHeader(ClientBookHeader* header, size_t size)
+{
+  if (memcmp(header->magic, CLIENTBOOK_MAGIC, sizeof(header->magic)) != 0
+      || header->version != CLIENTBOOK_VERSION || header->endian != CLIENTBOOK_ENDIAN)
+  {
+    return false;
+  }
+  uint64_t n = header->n;
+  if (n > (size - CLIENTBOOK_HEADER)/(5*sizeof(double)))
+  {
+    return false;
+  }
+  return header->offsetM == CLIENTBOOK_HEADER
+         && header->offsetS == align64(header->offsetM + n*sizeof(double))
+         && header->offsetP == align64(header->offsetS + n*sizeof(double))
+         && size == header->offsetP + 3*n*sizeof(double);
+}
+
+ClientBook* openClientBook(char* filename, bool verify)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+  {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < CLIENTBOOK_HEADER)
+  {
+    close(fd);
+    return NULL;
+  }
+  size_t size = st.st_size;
+  void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    return NULL;
+  }
+  ClientBookHeader* header = (ClientBookHeader*) map;
+  if (!validHeader(header, size)
+      || (verify && clientBookChecksum((char*) map + CLIENTBOOK_HEADER, size - CLIENTBOOK_HEADER) != header->checksum))
+  {
+    munmap(map, size);
+    return NULL;
+  }
+  ClientBook* book = malloc(sizeof(ClientBook));
+  book->n = header->n;
+  book->m = (double*) ((char*) map + header->offsetM);
+  book->s = (double*) ((char*) map + header->offsetS);
+  book->p = (double*) ((char*) map + header->offsetP);
+  book->map = map;
+  book->mapSize = size;
+  return book;
+}
+
+void bookClient(ClientBook* book, long i, InsuredClient* client)
+{
+  client->m = book->m[i];
+  client->s = book->s[i];
+  client->p = book->p + 3*i;
+}
+
+InsuredClient* bookClients(ClientBook* book)
+{
+  InsuredClient* clients = malloc((book->n > 0 ? book->n : 1)*sizeof(InsuredClient));
+  if (clients == NULL)
+  {
+    return NULL;
+  }
+  for (long i = 0; i < book->n; i++)
+  {
+    bookClient(book, i, &clients[i]);
+  }
+  return clients;
+}
@@ -0,0 +1,86 @@
+/*************************************/
+/* Header file clientbook.h          */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "pfa.h"
+
+#ifndef CLIENTBOOK_H
+#define CLIENTBOOK_H
+
+/* Book of clients stored by columns in a file, read by mapping the file in memory (mmap):
+   opening a book of any size costs no parsing and no allocation per client, the pages are
+   read when the clients are used.
+
+   File format (byte order of the machine, checked with the field endian):
+     header of CLIENTBOOK_HEADER bytes (ClientBookHeader)
+     m[n]     doubles, at offset offsetM
+     s[n]     doubles, at offset offsetS
+     p[3n]    doubles, at offset offsetP: p[3i], p[3i+1], p[3i+2] are the probabilities
+              of 0, 1 and 2 claims of client i
+   Each column starts at a multiple of 64 bytes, the gaps are filled with zeros.
+   The probabilities of a client are contiguous so that InsuredClient.p points directly
+   into the mapped file.
+   checksum is computed on the bytes from CLIENTBOOK_HEADER to the end of the file. */
+#define CLIENTBOOK_MAGIC "PFABOOK1"
+#define CLIENTBOOK_VERSION 1
+#define CLIENTBOOK_HEADER 64
+#define CLIENTBOOK_ENDIAN 0x01020304
+
+typedef struct{
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint64_t n;         /* Number of clients */
+  uint64_t offsetM;
+  uint64_t offsetS;
+  uint64_t offsetP;
+  uint64_t checksum;
+  uint64_t reserved;
+} ClientBookHeader;
+
+/* A mapped book. The columns are read-only. */
+typedef struct{
+  long n;
+  double* m;
+  double* s;
+  double* p;          /* 3n probabilities, client i: p + 3*i */
+  void* map;
+  size_t mapSize;
+} ClientBook;
+
+#ifdef CLIENTBOOK_C
+
+#else /* CLIENTBOOK_C */
+
+/* Writes the n clients in filename. Returns false if the file can not be written; a
+   partially written file is then removed. */
+extern bool writeClientBook(char* filename, InsuredClient* clients, long n);
+
+/* Maps filename. With verify, the checksum is computed (all the file is read).
+   Returns NULL if the file can not be mapped or is not a valid book (magic, version,
+   byte order, offsets and size, checksum). */
+extern ClientBook* openClientBook(char* filename, bool verify);
+
+extern void closeClientBook(ClientBook* book);
+
+/* View of client i of the book, usable by all the functions about insurance
+   (client->p points into the book: valid until closeClientBook) */
+extern void bookClient(ClientBook* book, long i, InsuredClient* client);
+
+/* Views of all the clients (one allocation of n InsuredClient, for portfolioDist for
+   instance), to be freed with free. NULL if the allocation fails. */
+extern InsuredClient* bookClients(ClientBook* book);
+
+/* Checksum of the n bytes of data (n multiple of 8): FNV-1a on 64-bit words */
+extern uint64_t clientBookChecksum(void* data, size_t n);
+
+#endif /* CLIENTBOOK_C */
+
+#endif /* CLIENTBOOK_H */
@@ -0,0 +1,414 @@
+#define CONVOLUTION_C
+
+#include "convolution.h"
+#include "fft.h"
+#include "threadpool.h"
+
+/* z^k by repeated squaring: k-1 multiplications at most, more accurate than cpow */
+static double complex powerInt(double complex z, int k)
+{
+  double complex result = 1.0;
+  while (k > 0)
+  {
+    if (k & 1)
+    {
+      result *= z;
+    }
+    z *= z;
+    k >>= 1;
+  }
+  return result;
+}
+
+/* Allocates a distribution on n cells, with all masses equal to 0 */
+static DiscreteDist* newDiscreteDist(double h, int n)
+{
+  if (h <= 0 || n < 1)
+  {
+    return NULL;
+  }
+  DiscreteDist* dist = malloc(sizeof(DiscreteDist));
+  if (dist == NULL)
+  {
+    return NULL;
+  }
+  dist->h = h;
+  dist->n = n;
+  dist->mass = calloc(n, sizeof(double));
+  dist->cdf = calloc(n, sizeof(double));
+  if (dist->mass == NULL || dist->cdf == NULL)
+  {
+    free(dist->mass);
+    free(dist->cdf);
+    free(dist);
+    return NULL;
+  }
+  return dist;
+}
+
+static void computeCDF(DiscreteDist* dist)
+{
+  double total = 0.0;
+  for (int i = 0; i < dist->n; i++)
+  {
+    total += dist->mass[i];
+    dist->cdf[i] = total;
+  }
+}
+
+/* CDF of the log-normal distribution of X, in closed form */
+static double lognormalCDF(InsuredClient* client, double x)
+{
+  if (x <= 0)
+  {
+    return 0.0;
+  }
+  return 0.5*erfc(-(log(x)-client->m)/(client->s*1.4142135623730951));
+}
+
+/* mass[i] : probability that X is in the cell i of the grid of step h, i = 0..n-1 */
+static void lognormalMasses(InsuredClient* client, double h, int n, double* mass)
+{
+  double previous = 0.0;
+  for (int i = 0; i < n; i++)
+  {
+    double next = lognormalCDF(client, (i+0.5)*h);
+    mass[i] = next - previous;
+    previous = next;
+  }
+}
+
+DiscreteDist* clientDist_X(InsuredClient* client, double h, int n)
+{
+  if (client == NULL)
+  {
+    return NULL;
+  }
+  DiscreteDist* dist = newDiscreteDist(h, n);
+  if (dist == NULL)
+  {
+    return NULL;
+  }
+  lognormalMasses(client, h, n, dist->mass);
+  computeCDF(dist);
+  return dist;
+}
+
+DiscreteDist* clientDist_Xk(InsuredClient* client, int k, double h, int n)
+{
+  /* Zero padding : the k-fold sum of cells 0..n-1 lies in cells 0..k(n-1) < L */
+  if (k < 1 || (long long) k*n > FFT_MAX_SIZE)
+  {
+    return NULL;
+  }
+  DiscreteDist* dist = clientDist_X(client, h, n);
+  if (dist == NULL || k == 1)
+  {
+    return dist;
+  }
+
+  int L = fftSize(k*n);
+  if (L < 2) L = 2;
+  double* padded = calloc(L, sizeof(double));
+  double complex* spectrum = malloc((L/2 + 1) * sizeof(double complex));
+  if (padded == NULL || spectrum == NULL)
+  {
+    free(padded);
+    free(spectrum);
+    free(dist->mass);
+    free(dist->cdf);
+    free(dist);
+    return NULL;
+  }
+  memcpy(padded, dist->mass, n * sizeof(double));
+
+  rfft(padded, spectrum, L);
+  for (int j = 0; j <= L/2; j++)
+  {
+    spectrum[j] = powerInt(spectrum[j], k);
+  }
+  irfft(spectrum, padded, L);
+
+  /* Rounding errors of the FFT can give tiny negative masses */
+  for (int i = 0; i < n; i++)
+  {
+    dist->mass[i] = (padded[i] > 0.0) ? padded[i] : 0.0;
+  }
+  computeCDF(dist);
+
+  free(padded);
+  free(spectrum);
+  return dist;
+}
+
+DiscreteDist* clientDist_X1X2(InsuredClient* client, double h, int n)
+{
+  return clientDist_Xk(client, 2, h, n);
+}
+
+/* The density is mass[i]/h at the centre i*h of cell i, and linear between two centres */
+double discretePDF(DiscreteDist* dist, double x)
+{
+  if (dist == NULL || x < 0)
+  {
+    return 0.0;
+  }
+  double u = x/dist->h;
+  int i = (int) floor(u);
+  if (i >= dist->n)
+  {
+    return 0.0;
+  }
+  double t = u - i;
+  double right = (i+1 < dist->n) ? dist->mass[i+1] : 0.0;
+  return ((1-t)*dist->mass[i] + t*right)/dist->h;
+}
+
+/* Cell i is [(i-1/2)h, (i+1/2)h[ : the CDF grows linearly by mass[i] on this cell */
+double discreteCDF(DiscreteDist* dist, double x)
+{
+  if (dist == NULL || x < 0)
+  {
+    return 0.0;
+  }
+  double u = x/dist->h + 0.5;
+  int i = (int) floor(u);
+  if (i >= dist->n)
+  {
+    return dist->cdf[dist->n - 1];
+  }
+  double t = u - i;
+  double before = (i > 0) ? dist->cdf[i-1] : 0.0;
+  if (i == 0)
+  {
+    /* Cell 0 is only [0, h/2[ */
+    t = 2.0*x/dist->h;
+  }
+  return before + t*dist->mass[i];
+}
+
+/* Inverse of discreteCDF: the CDF is linear on each cell */
+double discreteQuantile(DiscreteDist* dist, double alpha)
+{
+  if (dist == NULL || isnan(alpha) || alpha < 0 || alpha > 1)
+  {
+    return NAN;
+  }
+  if (alpha > dist->cdf[dist->n - 1])
+  {
+    return INFINITY;
+  }
+  /* First cell i with cdf[i] >= alpha */
+  int lo = -1, hi = dist->n - 1;
+  while (hi - lo > 1)
+  {
+    int mid = (lo + hi)/2;
+    if (dist->cdf[mid] >= alpha) hi = mid; else lo = mid;
+  }
+  int i = hi;
+  double before = (i > 0) ? dist->cdf[i-1] : 0.0;
+  double t = (dist->mass[i] > 0) ? (alpha - before)/dist->mass[i] : 0.0;
+  if (i == 0)
+  {
+    return t*dist->h/2;
+  }
+  return (i - 0.5 + t)*dist->h;
+}
+
+void freeDiscreteDist(DiscreteDist* dist)
+{
+  if (dist == NULL)
+  {
+    return;
+  }
+  free(dist->mass);
+  free(dist->cdf);
+  free(dist);
+}
+
+/* ==========================================================*/
+/* Distribution of the total of a portfolio                  */
+
+/* The transforms are computed on L = fftSize(4n) points. The masses are multiplied by
+   exp(-theta*i) before the transforms (exponential tilting), with theta*n = PORTFOLIO_TILT,
+   and the result by exp(theta*i): the mass beyond L, which wraps around, is damped by
+   exp(-theta*L) <= exp(-4*PORTFOLIO_TILT), and the rounding errors are amplified by at most
+   exp(PORTFOLIO_TILT) on the n cells which are returned. */
+#define PORTFOLIO_TILT 8.0
+/* Number of clients sorted at once by a task, to group the identical ones */
+#define PORTFOLIO_CHUNK 16384
+
+typedef struct{
+  double m;
+  double s;
+  double p[3];
+} ClientKey;
+
+static int compareClientKeys(const void* k1, const void* k2)
+{
+  double* a = (double*) k1;
+  double* b = (double*) k2;
+  for (int i = 0; i < 5; i++)
+  {
+    if (a[i] != b[i])
+    {
+      return (a[i] < b[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+typedef struct{
+  InsuredClient* clients;
+  int nclients;
+  int nlanes;
+  double h;
+  int n;
+  int L;
+  double theta;
+  double complex** products; /* products[lane] : product of the transforms of its clients */
+  bool failed;
+} Portfolio;
+
+/* Task of one lane: the clients lane*nclients/nlanes .. (lane+1)*nclients/nlanes - 1.
+   They are taken by chunks, sorted by (m, s, p): the transform of X is computed once for each
+   run of equal (m, s), and the transform of S once for each run of equal (m, s, p), raised to
+   the power of the number of clients in the run. */
+static void portfolioLane(int lane, void* data)
+{
+  Portfolio* pf = (Portfolio*) data;
+  int L = pf->L, half = L/2 + 1;
+  double complex* product = pf->products[lane];
+  double* padded = malloc(L * sizeof(double));
+  double complex* phiX = malloc(half * sizeof(double complex));
+  ClientKey* keys = malloc(PORTFOLIO_CHUNK * sizeof(ClientKey));
+  if (padded == NULL || phiX == NULL || keys == NULL)
+  {
+    pf->failed = true;
+    free(padded);
+    free(phiX);
+    free(keys);
+    return;
+  }
+  for (int j = 0; j < half; j++)
+  {
+    product[j] = 1.0;
+  }
+  int first = (int) ((long long) lane * pf->nclients / pf->nlanes);
+  int last = (int) ((long long) (lane+1) * pf->nclients / pf->nlanes);
+  double lastM = NAN, lastS = NAN;
+  for (int start = first; start < last; start += PORTFOLIO_CHUNK)
+  {
+    int size = (last - start < PORTFOLIO_CHUNK) ? last - start : PORTFOLIO_CHUNK;
+    for (int c = 0; c < size; c++)
+    {
+      InsuredClient* client = &pf->clients[start + c];
+      keys[c].m = client->m;
+      keys[c].s = client->s;
+      memcpy(keys[c].p, client->p, 3 * sizeof(double));
+    }
+    qsort(keys, size, sizeof(ClientKey), compareClientKeys);
+    for (int c = 0; c < size; )
+    {
+      int count = 1;
+      while (c + count < size && compareClientKeys(&keys[c], &keys[c + count]) == 0)
+      {
+        count++;
+      }
+      if (keys[c].m != lastM || keys[c].s != lastS)
+      {
+        /* Tilted masses of X on the n cells, and their transform */
+        InsuredClient client = {keys[c].m, keys[c].s, keys[c].p};
+        memset(padded, 0, L * sizeof(double));
+        lognormalMasses(&client, pf->h, pf->n, padded);
+        for (int i = 0; i < pf->n; i++)
+        {
+          padded[i] *= exp(-pf->theta*i);
+        }
+        rfft(padded, phiX, L);
+        lastM = keys[c].m;
+        lastS = keys[c].s;
+      }
+      /* Transform of S: p0 + p1*phiX + p2*phiX^2 (the mass p0 is at 0, not tilted) */
+      double* p = keys[c].p;
+      for (int j = 0; j < half; j++)
+      {
+        double complex psi = p[0] + phiX[j]*(p[1] + p[2]*phiX[j]);
+        product[j] *= (count == 1) ? psi : powerInt(psi, count);
+      }
+      c += count;
+    }
+  }
+  free(padded);
+  free(phiX);
+  free(keys);
+}
+
+DiscreteDist* portfolioDist(InsuredClient* clients, int nclients, double h, int n, int nthreads)
+{
+  /* The transforms have fftSize(4n) points */
+  if (clients == NULL || nclients < 0 || nthreads < 1 || (long long) 4*n > FFT_MAX_SIZE)
+  {
+    return NULL;
+  }
+  DiscreteDist* dist = newDiscreteDist(h, n);
+  if (dist == NULL)
+  {
+    return NULL;
+  }
+  Portfolio pf;
+  pf.clients = clients;
+  pf.nclients = nclients;
+  pf.nlanes = (nthreads < nclients) ? nthreads : ((nclients > 0) ? nclients : 1);
+  pf.h = h;
+  pf.n = n;
+  pf.L = fftSize(4*n);
+  pf.theta = PORTFOLIO_TILT/n;
+  pf.failed = false;
+  int half = pf.L/2 + 1;
+  pf.products = calloc(pf.nlanes, sizeof(double complex*));
+  double* padded = malloc(pf.L * sizeof(double));
+  for (int lane = 0; lane < pf.nlanes && pf.products != NULL; lane++)
+  {
+    pf.products[lane] = malloc(half * sizeof(double complex));
+    pf.failed = pf.failed || (pf.products[lane] == NULL);
+  }
+  if (pf.products == NULL || padded == NULL || pf.failed)
+  {
+    pf.failed = true;
+  }
+  else
+  {
+    parallelFor(getThreadPool(pf.nlanes), pf.nlanes, pf.nlanes, portfolioLane, &pf);
+  }
+  if (!pf.failed)
+  {
+    /* Product of the lanes, inverse transform, and untilting */
+    for (int lane = 1; lane < pf.nlanes; lane++)
+    {
+      for (int j = 0; j < half; j++)
+      {
+        pf.products[0][j] *= pf.products[lane][j];
+      }
+    }
+    irfft(pf.products[0], padded, pf.L);
+    for (int i = 0; i < n; i++)
+    {
+      double mass = padded[i]*exp(pf.theta*i);
+      dist->mass[i] = (mass > 0.0) ? mass : 0.0;
+    }
+    computeCDF(dist);
+  }
+  for (int lane = 0; lane < pf.nlanes && pf.products != NULL; lane++)
+  {
+    free(pf.products[lane]);
+  }
+  free(pf.products);
+  free(padded);
+  if (pf.failed)
+  {
+    freeDiscreteDist(dist);
+    return NULL;
+  }
+  return dist;
+}
@@ -0,0 +1,77 @@
+/*************************************/
+/* Header file convolution.h         */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "pfa.h"
+
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+/* Distribution of a positive random variable Y, discretised on the grid 0, h, 2h, ..., (n-1)h.
+   mass[i] is the probability that Y is in the cell [(i-1/2)h, (i+1/2)h[ (cell 0 is [0, h/2[).
+   The mass is considered uniformly spread on its cell, so that the CDF is piecewise linear.
+   The probability that Y is beyond the grid, i.e. 1 - cdf[n-1], is not represented.
+*/
+typedef struct{
+  double h;     /* Step of the grid */
+  int n;        /* Number of cells */
+  double* mass; /* mass[i] : probability of the cell i */
+  double* cdf;  /* cdf[i] = mass[0] + ... + mass[i] = P(Y < (i+1/2)h) */
+} DiscreteDist;
+
+#ifdef CONVOLUTION_C
+
+#else /* CONVOLUTION_C */
+
+/* Distribution of X (reimbursement of one claim) on the grid of step h with n cells.
+   mass[i] is computed exactly from the CDF of the log-normal distribution.
+   Returns NULL if h <= 0, n < 1 or if memory is missing. */
+extern DiscreteDist* clientDist_X(InsuredClient* client, double h, int n);
+
+/* Distribution of X1+...+Xk (k independent claims) on the same grid as clientDist_X.
+   The k-fold convolution of the masses of X is the inverse transform of the k-th power
+   of their real-to-complex FFT: O(L log L) operations with L ~ k*n (zero padding, so
+   that there is no wrap-around). The masses of X beyond the grid only change the
+   distribution beyond the grid, so the result is exact up to the discretisation of X.
+   Returns NULL if k < 1, if k*n > FFT_MAX_SIZE or if memory is missing. */
+extern DiscreteDist* clientDist_Xk(InsuredClient* client, int k, double h, int n);
+
+/* Distribution of X1+X2 : clientDist_Xk with k=2 */
+extern DiscreteDist* clientDist_X1X2(InsuredClient* client, double h, int n);
+
+/* Density and cumulative distribution function of the discretised variable at any x >= 0.
+   Beyond the grid, discretePDF returns 0 and discreteCDF returns cdf[n-1]. */
+extern double discretePDF(DiscreteDist* dist, double x);
+extern double discreteCDF(DiscreteDist* dist, double x);
+
+/* Smallest x such that discreteCDF(dist, x) >= alpha, for alpha in [0,1].
+   Returns INFINITY if alpha > cdf[n-1] (the quantile is beyond the grid), NAN if alpha is
+   not in [0,1]. */
+extern double discreteQuantile(DiscreteDist* dist, double alpha);
+
+/* Distribution of the total S_1 + ... + S_nclients of the reimbursements of independent
+   clients, on the grid of step h with n cells (n*h must be above the quantiles of interest).
+   The transform of S_i on the grid is p0 + p1*F + p2*F^2, where F is the transform of the
+   masses of X (clientDist_X): the transforms of the clients are multiplied, and the product
+   is transformed back once. Clients with the same (m, s) share F, and clients with the same
+   (m, s, p) are raised to a power. Exponential tilting avoids the wrap-around of the mass
+   beyond the transform (see PORTFOLIO_TILT).
+   The clients are split between nthreads tasks (threadpool.h). The memory is O(nthreads * n),
+   whatever the number of clients; the time is O(nclients * n) plus one transform per
+   distinct (m, s) in each chunk of clients. The result can differ by rounding errors with
+   nthreads. Returns NULL on an invalid argument (4*n > FFT_MAX_SIZE included) or if memory
+   is missing: the grid, or the n-sized buffers of a task. */
+extern DiscreteDist* portfolioDist(InsuredClient* clients, int nclients, double h, int n, int nthreads);
+
+extern void freeDiscreteDist(DiscreteDist* dist);
+
+#endif /* CONVOLUTION_C */
+
+#endif /* CONVOLUTION_H */
@@ -0,0 +1,120 @@
+#define FFT_C
+
+#include "fft.h"
+
+int fftSize(int n)
+{
+  if (n > FFT_MAX_SIZE)
+  {
+    return 0;
+  }
+  int size = 1;
+  while (size < n)
+  {
+    size *= 2;
+  }
+  return size;
+}
+
+/* Iterative radix-2 transform: bit reversal permutation, then log2(n) passes of butterflies.
+   The roots of unity are computed with cos/sin for each index (no accumulated rounding error).
+*/
+void fft(double complex* a, int n, bool inverse)
+{
+  for (int i = 1, j = 0; i < n; i++)
+  {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j)
+    {
+      double complex tmp = a[i];
+      a[i] = a[j];
+      a[j] = tmp;
+    }
+  }
+
+  double sign = inverse ? 1.0 : -1.0;
+  double complex* w = malloc((n/2 + 1) * sizeof(double complex));
+  for (int k = 0; k < n/2; k++)
+  {
+    double angle = sign * 2.0 * M_PI * k / n;
+    w[k] = cos(angle) + I * sin(angle);
+  }
+
+  for (int len = 2; len <= n; len *= 2)
+  {
+    int step = n / len;
+    for (int i = 0; i < n; i += len)
+    {
+      for (int k = 0; k < len/2; k++)
+      {
+        double complex u = a[i+k];
+        double complex v = a[i+k+len/2] * w[k*step];
+        a[i+k] = u + v;
+        a[i+k+len/2] = u - v;
+      }
+    }
+  }
+  free(w);
+
+  if (inverse)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      a[i] /= n;
+    }
+  }
+}
+
+/* The real values are packed two by two in n/2 complex values z[j] = in[2j] + i*in[2j+1].
+   The transform of the even and odd values are then separated using the symmetry
+   of the transform of a real sequence.
+*/
+void rfft(double* in, double complex* out, int n)
+{
+  int m = n/2;
+  double complex* z = malloc(m * sizeof(double complex));
+  for (int j = 0; j < m; j++)
+  {
+    z[j] = in[2*j] + I * in[2*j+1];
+  }
+  fft(z, m, false);
+
+  for (int k = 0; k <= m; k++)
+  {
+    double complex zk  = z[k % m];
+    double complex zmk = conj(z[(m - k) % m]);
+    double complex even = (zk + zmk) / 2.0;
+    double complex odd  = (zk - zmk) / (2.0 * I);
+    double angle = -2.0 * M_PI * k / n;
+    out[k] = even + (cos(angle) + I * sin(angle)) * odd;
+  }
+  free(z);
+}
+
+void irfft(double complex* in, double* out, int n)
+{
+  int m = n/2;
+  double complex* z = malloc(m * sizeof(double complex));
+  for (int k = 0; k < m; k++)
+  {
+    double complex xk  = in[k];
+    double complex xmk = conj(in[m - k]);
+    double complex even = (xk + xmk) / 2.0;
+    double angle = 2.0 * M_PI * k / n;
+    double complex odd  = (xk - xmk) / 2.0 * (cos(angle) + I * sin(angle));
+    z[k] = even + I * odd;
+  }
+  fft(z, m, true);
+
+  for (int j = 0; j < m; j++)
+  {
+    out[2*j]   = creal(z[j]);
+    out[2*j+1] = cimag(z[j]);
+  }
+  free(z);
+}
@@ -0,0 +1,41 @@
+/*************************************/
+/* Header file fft.h                 */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+
+#ifndef FFT_H
+#define FFT_H
+
+/* Largest size of a transform (the sizes are int) */
+#define FFT_MAX_SIZE (1 << 30)
+
+#ifdef FFT_C
+
+#else /* FFT_C */
+
+/* Returns the smallest power of 2 which is >= n, or 0 if n > FFT_MAX_SIZE */
+extern int fftSize(int n);
+
+/* Discrete Fourier transform of the n complex values a[0..n-1], computed in place.
+   n must be a power of 2.
+   The inverse transform (inverse=true) is normalised: fft(fft(a), inverse) = a. */
+extern void fft(double complex* a, int n, bool inverse);
+
+/* Transform of the n real values in[0..n-1] (n power of 2, n >= 2).
+   Only the n/2+1 first coefficients out[0..n/2] are computed: the other ones are
+   their complex conjugates. The work is one complex fft of size n/2. */
+extern void rfft(double* in, double complex* out, int n);
+
+/* Inverse of rfft: computes the n real values out[0..n-1] from in[0..n/2].
+   Array in is modified. */
+extern void irfft(double complex* in, double* out, int n);
+
+#endif /* FFT_C */
+
+#endif /* FFT_H */
@@ -0,0 +1,252 @@
+#define INSTRUMENT_C
+
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include <pthread.h>
+#include "instrument.h"
+
+#ifdef PFA_INSTRUMENT
+
+typedef struct{
+  char* name;
+  long long start;    /* ns */
+  long long duration; /* ns */
+} InstrEvent;
+
+/* State of one thread. It is created by the first instrumented call of the thread, and
+   kept (in the list of all the threads) after its end, for the exports. */
+struct InstrThread{
+  int id;
+  InstrCounters counters;
+  int depth;          /* Current nesting of integrations */
+  int scopes;         /* Current nesting of timed scopes */
+  InstrEvent* events; /* INSTRUMENT_MAX_EVENTS events */
+  InstrThread* next;
+};
+
+static __thread InstrThread* self = NULL;
+static InstrThread* threads = NULL;
+static int nbThreads = 0;
+static pthread_mutex_t threadsLock = PTHREAD_MUTEX_INITIALIZER;
+static long long origin = 0;
+
+static long long nowNs(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long) t.tv_sec*1000000000LL + t.tv_nsec;
+}
+
+static InstrThread* registerThread(void)
+{
+  InstrThread* t = calloc(1, sizeof(InstrThread));
+  t->events = malloc(INSTRUMENT_MAX_EVENTS*sizeof(InstrEvent));
+  pthread_mutex_lock(&threadsLock);
+  if (origin == 0)
+  {
+    origin = nowNs();
+  }
+  t->id = nbThreads++;
+  t->next = threads;
+  threads = t;
+  pthread_mutex_unlock(&threadsLock);
+  self = t;
+  return t;
+}
+
+static InstrThread* current(void)
+{
+  return (self != NULL) ? self : registerThread();
+}
+
+InstrCounters* instrCounters(void)
+{
+  return &current()->counters;
+}
+
+InstrScope instrBeginScope(char* name)
+{
+  InstrThread* t = current();
+  InstrScope scope = {name, 0, false};
+  t->scopes++;
+  if (t->scopes <= INSTRUMENT_TRACE_DEPTH)
+  {
+    scope.recorded = true;
+    scope.start = nowNs();
+  }
+  return scope;
+}
+
+void instrEndScope(InstrScope* scope)
+{
+  InstrThread* t = current();
+  t->scopes--;
+  if (!scope->recorded)
+  {
+    return;
+  }
+  if (t->counters.events < INSTRUMENT_MAX_EVENTS && t->events != NULL)
+  {
+    InstrEvent* e = &t->events[t->counters.events++];
+    e->name = scope->name;
+    e->start = scope->start;
+    e->duration = nowNs() - scope->start;
+  }
+  else
+  {
+    t->counters.droppedEvents++;
+  }
+}
+
+int instrEnterIntegral(long subintervals, long evals)
+{
+  InstrThread* t = current();
+  t->counters.integrations++;
+  t->counters.subintervals += subintervals;
+  t->counters.integrandCalls += evals;
+  t->depth++;
+  if (t->depth > t->counters.maxDepth)
+  {
+    t->counters.maxDepth = t->depth;
+  }
+  return t->depth;
+}
+
+void instrLeaveIntegral(int* depth)
+{
+  (void) depth;
+  current()->depth--;
+}
+
+bool instrEnabled(void)
+{
+  return true;
+}
+
+void instrThreadCounters(InstrCounters* counters)
+{
+  *counters = current()->counters;
+}
+
+static void addCounters(InstrCounters* total, InstrCounters* c)
+{
+  total->integrations += c->integrations;
+  total->subintervals += c->subintervals;
+  total->integrandCalls += c->integrandCalls;
+  total->maxDepth = (c->maxDepth > total->maxDepth) ? c->maxDepth : total->maxDepth;
+  total->phiCalls += c->phiCalls;
+  total->PHICalls += c->PHICalls;
+  total->events += c->events;
+  total->droppedEvents += c->droppedEvents;
+}
+
+void instrTotalCounters(InstrCounters* counters)
+{
+  memset(counters, 0, sizeof(InstrCounters));
+  pthread_mutex_lock(&threadsLock);
+  for (InstrThread* t = threads; t != NULL; t = t->next)
+  {
+    addCounters(counters, &t->counters);
+  }
+  pthread_mutex_unlock(&threadsLock);
+}
+
+void instrReset(void)
+{
+  pthread_mutex_lock(&threadsLock);
+  for (InstrThread* t = threads; t != NULL; t = t->next)
+  {
+    memset(&t->counters, 0, sizeof(InstrCounters));
+  }
+  origin = nowNs();
+  pthread_mutex_unlock(&threadsLock);
+}
+
+bool instrWriteTrace(char* filename)
+{
+  FILE* file = fopen(filename, "w");
+  if (file == NULL)
+  {
+    return false;
+  }
+  fprintf(file, "{\"traceEvents\": [");
+  bool first = true;
+  pthread_mutex_lock(&threadsLock);
+  for (InstrThread* t = threads; t != NULL; t = t->next)
+  {
+    fprintf(file, "%s\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+            first ? "" : ",", t->id, t->id);
+    first = false;
+    for (long i = 0; i < t->counters.events; i++)
+    {
+      InstrEvent* e = &t->events[i];
+      fprintf(file, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+              e->name, t->id, (e->start - origin)/1000.0, e->duration/1000.0);
+    }
+  }
+  pthread_mutex_unlock(&threadsLock);
+  fprintf(file, "\n], \"displayTimeUnit\": \"ns\"}\n");
+  return fclose(file) == 0;
+}
+
+static void writeCounters(FILE* file, InstrCounters* c)
+{
+  fprintf(file, "{\"integrations\": %ld, \"subintervals\": %ld, \"integrand_calls\": %ld, \"max_depth\": %d, "
+          "\"phi_calls\": %ld, \"PHI_calls\": %ld, \"events\": %ld, \"dropped_events\": %ld}",
+          c->integrations, c->subintervals, c->integrandCalls, c->maxDepth,
+          c->phiCalls, c->PHICalls, c->events, c->droppedEvents);
+}
+
+bool instrWriteSnapshot(FILE* file)
+{
+  InstrCounters total;
+  instrTotalCounters(&total);
+  fprintf(file, "{\"threads\": [");
+  pthread_mutex_lock(&threadsLock);
+  for (InstrThread* t = threads; t != NULL; t = t->next)
+  {
+    fprintf(file, "%s\n  {\"tid\": %d, \"counters\": ", (t == threads) ? "" : ",", t->id);
+    writeCounters(file, &t->counters);
+    fprintf(file, "}");
+  }
+  pthread_mutex_unlock(&threadsLock);
+  fprintf(file, "\n], \"total\": ");
+  writeCounters(file, &total);
+  fprintf(file, "}\n");
+  return !ferror(file);
+}
+
+#else /* PFA_INSTRUMENT */
+
+bool instrEnabled(void)
+{
+  return false;
+}
+
+void instrThreadCounters(InstrCounters* counters)
+{
+  memset(counters, 0, sizeof(InstrCounters));
+}
+
+void instrTotalCounters(InstrCounters* counters)
+{
+  memset(counters, 0, sizeof(InstrCounters));
+}
+
+void instrReset(void)
+{
+}
+
+bool instrWriteTrace(char* filename)
+{
+  (void) filename;
+  return false;
+}
+
+bool instrWriteSnapshot(FILE* file)
+{
+  (void) file;
+  return false;
+}
+
+#endif /* PFA_INSTRUMENT */
@@ -0,0 +1,105 @@
+/*************************************/
+/* Header file instrument.h          */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+/* Instrumentation of integration.c and pfa.c, compiled only with -DPFA_INSTRUMENT.
+   Without it, the macros below are empty (no cost at all), and the functions of this file
+   return zeros (instrEnabled returns false).
+   Each thread has its own counters and its own buffer of trace events: the instrumented
+   code never takes a lock. The counters of all the threads are read by instrTotalCounters,
+   and the events are written by instrWriteTrace: call them when no computation runs. */
+
+/* Counters of one thread (or the sum over all threads) */
+typedef struct{
+  long integrations;  /* Calls to the integration functions (integrate, integrate_r, ...) */
+  long subintervals;  /* Subdivisions integrated by a quadrature formula (or Kronrod rule) */
+  long integrandCalls;/* Evaluations of the integrands */
+  int maxDepth;       /* Deepest nesting of integrations (2 for the double integral of X1+X2) */
+  long phiCalls;      /* Evaluations of the density of N(0,1) (phi, phi_batch, clientPDF_X) */
+  long PHICalls;      /* Evaluations of PHI (PHI_r, vecPHI in the batch functions) */
+  long events;        /* Timed scopes recorded in the trace */
+  long droppedEvents; /* Timed scopes not recorded, the buffer being full */
+} InstrCounters;
+
+/* Maximal number of events kept by each thread */
+#define INSTRUMENT_MAX_EVENTS 65536
+
+/* Timed scopes nested deeper than this are counted but not recorded (the inner integrals
+   of clientCDF_X1X2 would fill the buffer) */
+#define INSTRUMENT_TRACE_DEPTH 4
+
+#ifdef PFA_INSTRUMENT
+
+typedef struct InstrThread InstrThread;
+
+/* State of a timed scope, ended when the variable goes out of scope (GCC cleanup attribute) */
+typedef struct{
+  char* name;
+  long long start;
+  bool recorded;
+} InstrScope;
+
+extern InstrScope instrBeginScope(char* name);
+extern void instrEndScope(InstrScope* scope);
+extern int instrEnterIntegral(long subintervals, long evals);
+extern void instrLeaveIntegral(int* depth);
+extern InstrCounters* instrCounters(void);
+
+/* Timer from here to the end of the enclosing block, recorded as a trace event */
+#define INSTRUMENT_SCOPE(name) \
+  InstrScope instrScope __attribute__((cleanup(instrEndScope))) = instrBeginScope(name)
+/* One integration of N subdivisions with evals evaluations of the integrand, nested until
+   the end of the enclosing block */
+#define INSTRUMENT_INTEGRAL(N, evals) \
+  int instrDepth __attribute__((cleanup(instrLeaveIntegral))) = instrEnterIntegral(N, evals)
+/* Subdivisions and evaluations known only at the end of an integration */
+#define INSTRUMENT_EVALS(N, evals) \
+  do { InstrCounters* c = instrCounters(); c->subintervals += (N); c->integrandCalls += (evals); } while (0)
+#define INSTRUMENT_PHI(n) (instrCounters()->phiCalls += (n))
+#define INSTRUMENT_CDF(n) (instrCounters()->PHICalls += (n))
+
+#else /* PFA_INSTRUMENT */
+
+#define INSTRUMENT_SCOPE(name)
+#define INSTRUMENT_INTEGRAL(N, evals)
+#define INSTRUMENT_EVALS(N, evals)
+#define INSTRUMENT_PHI(n)
+#define INSTRUMENT_CDF(n)
+
+#endif /* PFA_INSTRUMENT */
+
+#ifdef INSTRUMENT_C
+
+#else /* INSTRUMENT_C */
+
+/* true if the library has been compiled with -DPFA_INSTRUMENT */
+extern bool instrEnabled(void);
+
+/* Counters of the calling thread, and sum of the counters of all the threads
+   (maxDepth is then the maximum) */
+extern void instrThreadCounters(InstrCounters* counters);
+extern void instrTotalCounters(InstrCounters* counters);
+
+/* Sets all the counters to 0 and removes all the events, in all the threads */
+extern void instrReset(void);
+
+/* Writes the events of all the threads in the Chrome trace format (chrome://tracing,
+   Perfetto): one complete event ("ph": "X") per timed scope, in microseconds.
+   Returns false if the file can not be written, or without PFA_INSTRUMENT. */
+extern bool instrWriteTrace(char* filename);
+
+/* Writes the counters of each thread and their sum as a JSON object */
+extern bool instrWriteSnapshot(FILE* file);
+
+#endif /* INSTRUMENT_C */
+
+#endif /* INSTRUMENT_H */
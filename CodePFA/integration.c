@@ -4,72 +4,289 @@
 
 #define INTEGRATION_C
 
+#include <pthread.h>
+#include <float.h>
 #include "integration.h"
+#include "threadpool.h"
+#include "instrument.h"
 
-bool setQuadFormula(QuadFormula* qf, char* name)
+/* ==========================================================*/
+/* Table of the quadrature formulas                           */
+
+/* Handles: the 7 fixed formulas, then the families gaussN, lobattoN and clenshawN,
+   each one with QUAD_MAX_NODES entries (entry N-1 of a family has N nodes). */
+#define NB_FIXED_RULES 7
+#define RULE_GAUSS   NB_FIXED_RULES
+#define RULE_LOBATTO (RULE_GAUSS+QUAD_MAX_NODES)
+#define RULE_CLENSHAW (RULE_LOBATTO+QUAD_MAX_NODES)
+#define NB_RULES (RULE_CLENSHAW+QUAD_MAX_NODES)
+
+/* Nodes and weights of the 7 fixed formulas, with their number of nodes */
+typedef struct{
+  char* name;
+  int n;
+  double x[3];
+  double w[3];
+} FixedRule;
+
+static const FixedRule fixedRules[NB_FIXED_RULES] = {
+  {"left",     1, {0.0},                 {1.0}},
+  {"right",    1, {1.0},                 {1.0}},
+  {"middle",   1, {1.0/2.0},             {1.0}},
+  {"trapezes", 2, {0.0, 1.0},            {1.0/2.0, 1.0/2.0}},
+  {"simpson",  3, {0.0, 1.0/2.0, 1.0},   {1.0/6.0, 2.0/3.0, 1.0/6.0}},
+  /* 1/2 -+ 1/(2*sqrt(3)), correctly rounded */
+  {"gauss2",   2, {0.21132486540518708, 0.7886751345948129}, {1.0/2.0, 1.0/2.0}},
+  /* (1 -+ sqrt(3/5))/2, correctly rounded */
+  {"gauss3",   3, {0.1127016653792583, 1.0/2.0, 0.8872983346207417}, {5.0/18.0, 4.0/9.0, 5.0/18.0}}
+};
+
+typedef struct{
+  char name[20];
+  int n;
+  double* x;
+  double* w;
+} RuleTable;
+
+static RuleTable rules[NB_RULES];
+static pthread_mutex_t rulesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Legendre polynomial P_n(t) and its derivative, by the recurrence
+   (k+1) P_{k+1} = (2k+1) t P_k - k P_{k-1} */
+static void legendre(int n, double t, double* p, double* dp)
+{
+  double p0 = 1.0, p1 = t;
+  if (n == 0)
+  {
+    p1 = 1.0;
+  }
+  for (int k = 1; k < n; k++)
+  {
+    double p2 = ((2*k+1)*t*p1 - k*p0)/(k+1);
+    p0 = p1;
+    p1 = p2;
+  }
+  *p = p1;
+  /* (1-t^2) P_n' = n (P_{n-1} - t P_n) */
+  *dp = (n == 0) ? 0.0 : n*(p0 - t*p1)/(1-t*t);
+}
+
+/* The nodes t of the formulas below are in [-1,1], with weights of sum 2.
+   They are mapped to [0,1] by x = (1+t)/2 and w/2. */
+
+/* Gauss-Legendre: the nodes are the roots of P_n, found by Newton iterations from
+   cos(pi(i+3/4)/(n+1/2)), and w = 2/((1-t^2) P_n'(t)^2) */
+static void buildGauss(int n, double* x, double* w)
+{
+  for (int i = 0; i < n; i++)
+  {
+    double t = cos(M_PI*(i+0.75)/(n+0.5));
+    double p, dp;
+    for (int iter = 0; iter < 100; iter++)
+    {
+      legendre(n, t, &p, &dp);
+      double step = p/dp;
+      t -= step;
+      if (fabs(step) < 1e-16)
+      {
+        break;
+      }
+    }
+    legendre(n, t, &p, &dp);
+    /* Nodes in increasing order: t decreases with i */
+    x[n-1-i] = (1+t)/2;
+    w[n-1-i] = 1.0/((1-t*t)*dp*dp);
+  }
+}
+
+/* Gauss-Lobatto: nodes -1, 1 and the roots of P_{n-1}', found by Newton iterations from
+   the Chebyshev points cos(pi i/(n-1)); w = 2/(n(n-1) P_{n-1}(t)^2) */
+static void buildLobatto(int n, double* x, double* w)
+{
+  int m = n-1;
+  for (int i = 0; i < n; i++)
+  {
+    double t = cos(M_PI*i/m);
+    if (i > 0 && i < m)
+    {
+      for (int iter = 0; iter < 100; iter++)
+      {
+        double p, dp;
+        legendre(m, t, &p, &dp);
+        /* (1-t^2) P'' = 2t P' - m(m+1) P */
+        double d2p = (2*t*dp - m*(m+1)*p)/(1-t*t);
+        double step = dp/d2p;
+        t -= step;
+        if (fabs(step) < 1e-16)
+        {
+          break;
+        }
+      }
+    }
+    double p, dp;
+    legendre(m, t, &p, &dp);
+    x[m-i] = (1+t)/2;
+    w[m-i] = 1.0/(n*m*p*p);
+  }
+  x[0] = 0.0;
+  x[m] = 1.0;
+}
+
+/* Clenshaw-Curtis: nodes t_k = cos(k pi/m), m = n-1, and
+   w_k = c_k/m (1 - sum_{j=1}^{m/2} b_j/(4j^2-1) cos(2jk pi/m)),
+   with c_0 = c_m = 1, c_k = 2 otherwise, b_{m/2} = 1 if m is even, b_j = 2 otherwise */
+static void buildClenshaw(int n, double* x, double* w)
+{
+  int m = n-1;
+  for (int k = 0; k <= m; k++)
+  {
+    double s = 0.0;
+    for (int j = 1; j <= m/2; j++)
+    {
+      double b = (2*j == m) ? 1.0 : 2.0;
+      s += b/(4.0*j*j-1)*cos(2.0*j*k*M_PI/m);
+    }
+    double c = (k == 0 || k == m) ? 1.0 : 2.0;
+    x[m-k] = (1+cos(k*M_PI/m))/2;
+    w[m-k] = c/m*(1-s)/2;
+  }
+  x[0] = 0.0;
+  x[m] = 1.0;
+}
+
+/* Computes the table of a formula if needed. rulesLock must be held.
+   Returns false if memory is missing. */
+static bool buildRule(QuadRule rule)
 {
-  if (strcmp(name, "left") == 0)
+  RuleTable* table = &rules[rule];
+  if (table->x != NULL)
+  {
+    return true;
+  }
+  int n;
+  if (rule < NB_FIXED_RULES)
   {
-    qf->n=1;
-    qf->w[0] = 1.0;
-    qf->x[0] = 0.0;
+    n = fixedRules[rule].n;
+    snprintf(table->name, sizeof(table->name), "%s", fixedRules[rule].name);
   }
-  else if (strcmp(name, "right") == 0)
+  else
   {
-    qf->n=1;
-    qf->w[0] = 1.0;
-    qf->x[0] = 1.0;
+    n = (rule - NB_FIXED_RULES)%QUAD_MAX_NODES + 1;
+    char* family = (rule < RULE_LOBATTO) ? "gauss" : ((rule < RULE_CLENSHAW) ? "lobatto" : "clenshaw");
+    snprintf(table->name, sizeof(table->name), "%s%d", family, n);
   }
-  else if (strcmp(name, "middle") == 0)
+  double* x = malloc(n*sizeof(double));
+  double* w = malloc(n*sizeof(double));
+  if (x == NULL || w == NULL)
   {
-    qf->n=1;
-    qf->w[0] = 1.0;
-    qf->x[0] = 1.0/2.0;
+    free(x);
+    free(w);
+    return false;
   }
-  else if (strcmp(name, "trapezes") == 0)
+  if (rule < NB_FIXED_RULES)
   {
-    qf->n=2;
-    qf->w[0] = 1.0/2.0;
-    qf->w[1] = 1.0/2.0;
-    qf->x[0] = 0.0;
-    qf->x[1] = 1.0;
+    memcpy(x, fixedRules[rule].x, n*sizeof(double));
+    memcpy(w, fixedRules[rule].w, n*sizeof(double));
   }
-  else if (strcmp(name, "simpson") == 0)
+  else if (rule < RULE_LOBATTO)
   {
-    qf->n=3;
-    qf->w[0] = 1.0/6.0;
-    qf->w[1] = 2.0/3.0;
-    qf->w[2] = 1.0/6.0;
-    qf->x[0] = 0.0;
-    qf->x[1] = 1.0/2.0;
-    qf->x[2] = 1.0;
+    buildGauss(n, x, w);
   }
-  else if (strcmp(name, "gauss2") == 0)
+  else if (rule < RULE_CLENSHAW)
   {
-    qf->n=2;
-    qf->w[0] = 1.0/2.0;
-    qf->w[1] = 1.0/2.0;
-    qf->x[0] = 1.0/2.0-1.0/(2*sqrt(3));
-    qf->x[1] = 1.0/2.0+1.0/(2*sqrt(3));
+    buildLobatto(n, x, w);
   }
-  else if (strcmp(name, "gauss3") == 0)
+  else
   {
-    qf->n=3;
-    qf->w[0] = 5.0/18.0;
-    qf->w[1] = 4.0/9.0;
-    qf->w[2] = 5.0/18.0;
-    qf->x[0] = 1.0/2.0*(1-sqrt(3.0/5.0));
-    qf->x[1] = 1.0/2.0;
-    qf->x[2] = 1.0/2.0*(1+sqrt(3.0/5.0));;
+    buildClenshaw(n, x, w);
   }
+  table->n = n;
+  table->w = w;
+  table->x = x;
   return true;
 }
 
+/* Number N at the end of name after prefix, or -1 */
+static int nodesInName(char* name, char* prefix)
+{
+  size_t len = strlen(prefix);
+  if (strncmp(name, prefix, len) != 0 || name[len] < '1' || name[len] > '9')
+  {
+    return -1;
+  }
+  char* end;
+  long n = strtol(name+len, &end, 10);
+  return (*end == '\0' && n <= QUAD_MAX_NODES) ? (int) n : -1;
+}
+
+QuadRule findQuadRule(char* name)
+{
+  if (name == NULL)
+  {
+    return -1;
+  }
+  QuadRule rule = -1;
+  for (int i = 0; i < NB_FIXED_RULES; i++)
+  {
+    if (strcmp(name, fixedRules[i].name) == 0)
+    {
+      rule = i;
+    }
+  }
+  int n;
+  if (rule < 0 && (n = nodesInName(name, "gauss")) >= 1)
+  {
+    rule = RULE_GAUSS + n-1;
+  }
+  if (rule < 0 && (n = nodesInName(name, "lobatto")) >= 2)
+  {
+    rule = RULE_LOBATTO + n-1;
+  }
+  if (rule < 0 && (n = nodesInName(name, "clenshaw")) >= 2)
+  {
+    rule = RULE_CLENSHAW + n-1;
+  }
+  if (rule >= 0)
+  {
+    pthread_mutex_lock(&rulesLock);
+    if (!buildRule(rule))
+    {
+      rule = -1;
+    }
+    pthread_mutex_unlock(&rulesLock);
+  }
+  return rule;
+}
+
+/* rule must have been returned by findQuadRule, so that its table is built */
+bool setQuadRule(QuadFormula* qf, QuadRule rule)
+{
+  if (qf == NULL || rule < 0 || rule >= NB_RULES || rules[rule].x == NULL)
+  {
+    return false;
+  }
+  memcpy(qf->name, rules[rule].name, sizeof(qf->name));
+  qf->n = rules[rule].n;
+  qf->x = rules[rule].x;
+  qf->w = rules[rule].w;
+  qf->rule = rule;
+  return true;
+}
+
+bool setQuadFormula(QuadFormula* qf, char* name)
+{
+  return setQuadRule(qf, findQuadRule(name));
+}
+
 /* This function is not required ,but it may useful to debug */
 void printQuadFormula(QuadFormula* qf)
 {
   printf("Quadratic formula: %s\n", qf->name);
   /* Print everything else that may be useful */
+  for (int i = 0; i < qf->n; i++)
+  {
+    printf("  x[%d] = %.17f  w[%d] = %.17f\n", i, qf->x[i], i, qf->w[i]);
+  }
 }
 
 double sum(double (*f)(double), double ai, double bi, QuadFormula* qf)
@@ -103,6 +320,8 @@ double base(double (*f)(double), double ai, double bi, QuadFormula* qf)
 // }
 double integrate(double (*f)(double), double a, double b, int N, QuadFormula* qf)
 {
+  INSTRUMENT_SCOPE("integrate");
+  INSTRUMENT_INTEGRAL(N, (long) N*qf->n);
   double total=0;
   double sub=(b-a)/N;
   for (int i = 0; i < N; i++)
@@ -117,10 +336,661 @@ double integrate(double (*f)(double), double a, double b, int N, QuadFormula* qf
   return total;
 }
 
+/* Number of subdivisions N such that |b-a|/N ~ dx.
+   N is at least 1, so that a very small interval is still integrated. */
+static int nbSubdivisions(double a, double b, double dx)
+{
+  int N = (int) round( sqrt((b-a)*(b-a))/dx );
+  return (N < 1) ? 1 : N;
+}
+
 double integrate_dx(double (*f)(double), double a, double b, double dx, QuadFormula* qf)
 {
 
-  return integrate(f, a, b,(int) round( sqrt((b-a)*(b-a))/dx ), qf);
+  return integrate(f, a, b, nbSubdivisions(a, b, dx), qf);
+}
+
+/* ==========================================================*/
+/* Reentrant versions: the integrand takes a void* argument   */
+
+/* Default maximal number of evaluations of the adaptive mode */
+#define ADAPTIVE_MAX_EVALS 1000000
+
+bool setIntegrationTolerance(IntegrationConfig* cfg, double epsabs, double epsrel, int maxEvals)
+{
+  if (cfg == NULL || epsabs < 0 || epsrel < 0 || (epsabs == 0 && epsrel == 0) || maxEvals < 15)
+  {
+    return false;
+  }
+  cfg->adaptive = true;
+  cfg->epsabs = epsabs;
+  cfg->epsrel = epsrel;
+  cfg->maxEvals = maxEvals;
+  return true;
+}
+
+bool setIntegrationConfig(IntegrationConfig* cfg, char* quadrature, double dx)
+{
+  if (cfg == NULL || dx <= 0)
+  {
+    return false;
+  }
+  cfg->dx = dx;
+  cfg->threads = 1;
+  cfg->parallelThreshold = 16*INTEGRATION_BLOCK;
+  cfg->adaptive = false;
+  cfg->epsabs = 0.0;
+  cfg->epsrel = 0.0;
+  cfg->maxEvals = ADAPTIVE_MAX_EVALS;
+  if (strcmp(quadrature, "adaptive") == 0)
+  {
+    /* qf is still used by functions which have no adaptive mode */
+    setQuadFormula(&cfg->qf, "gauss3");
+    return setIntegrationTolerance(cfg, dx, dx, ADAPTIVE_MAX_EVALS);
+  }
+  return setQuadFormula(&cfg->qf, quadrature);
+}
+
+static double sum_r(double (*f)(double, void*), void* data, double ai, double bi, QuadFormula* qf)
+{
+  double summ=0;
+  for (int i = 0; i < qf->n; i++)
+  {
+    summ+=(qf->w[i])*(f(ai+(qf->x[i]*(bi-ai)), data));
+  }
+  return summ;
+}
+
+double integrate_r(double (*f)(double, void*), void* data, double a, double b, int N, QuadFormula* qf)
+{
+  INSTRUMENT_SCOPE("integrate_r");
+  INSTRUMENT_INTEGRAL(N, (long) N*qf->n);
+  double total=0;
+  double sub=(b-a)/N;
+  for (int i = 0; i < N; i++)
+  {
+    double ai=a+i*sub;
+    double bi =a+(i+1)*sub;
+    total+=(bi-ai)*sum_r(f, data, ai, bi, qf);
+  }
+  return total;
+}
+
+/* Adapter for the functions without data: data points to the function pointer */
+typedef struct{
+  double (*f)(double);
+} Integrand;
+
+static double callIntegrand(double x, void* data)
+{
+  return ((Integrand*) data)->f(x);
+}
+
+/* ==========================================================*/
+/* Parallel integration with a deterministic reduction        */
+
+typedef struct{
+  double (*f)(double, void*);
+  void* data;
+  double a;
+  double sub;      /* Length of a subdivision */
+  int N;
+  QuadFormula* qf;
+  double* blocks;  /* blocks[i] : integral on the subdivisions of block i */
+} ParallelIntegral;
+
+static void integrateBlock(int block, void* arg)
+{
+  ParallelIntegral* p = (ParallelIntegral*) arg;
+  int first = block*INTEGRATION_BLOCK;
+  int last = (first+INTEGRATION_BLOCK < p->N) ? first+INTEGRATION_BLOCK : p->N;
+  double total=0;
+  for (int i = first; i < last; i++)
+  {
+    double ai=p->a+i*p->sub;
+    double bi=p->a+(i+1)*p->sub;
+    total+=(bi-ai)*sum_r(p->f, p->data, ai, bi, p->qf);
+  }
+  p->blocks[block] = total;
+}
+
+/* Sum of values[first..last-1], always added in the same order */
+static double pairwiseSum(double* values, int first, int last)
+{
+  if (last - first == 1)
+  {
+    return values[first];
+  }
+  int middle = first + (last-first)/2;
+  return pairwiseSum(values, first, middle) + pairwiseSum(values, middle, last);
+}
+
+double integrate_parallel_r(double (*f)(double, void*), void* data, double a, double b, int N, QuadFormula* qf, int nthreads)
+{
+  INSTRUMENT_SCOPE("integrate_parallel_r");
+  INSTRUMENT_INTEGRAL(N, (long) N*qf->n);
+  if (N < 1)
+  {
+    return 0.0;
+  }
+  int nblocks = (N + INTEGRATION_BLOCK-1)/INTEGRATION_BLOCK;
+  ParallelIntegral p = {f, data, a, (b-a)/N, N, qf, malloc(nblocks*sizeof(double))};
+  parallelFor((nthreads > 1) ? getThreadPool(nthreads) : NULL, nthreads, nblocks, integrateBlock, &p);
+  double total = pairwiseSum(p.blocks, 0, nblocks);
+  free(p.blocks);
+  return total;
+}
+
+double integrate_parallel(double (*f)(double), double a, double b, int N, QuadFormula* qf, int nthreads)
+{
+  Integrand integrand = {f};
+  return integrate_parallel_r(callIntegrand, &integrand, a, b, N, qf, nthreads);
+}
+
+bool setIntegrationThreads(IntegrationConfig* cfg, int nthreads, int threshold)
+{
+  if (cfg == NULL || nthreads < 1)
+  {
+    return false;
+  }
+  cfg->threads = nthreads;
+  cfg->parallelThreshold = threshold;
+  return true;
+}
+
+/* ==========================================================*/
+/* Adaptive Gauss-Kronrod (G7-K15) integration                */
+
+/* Nodes of the Kronrod rule on [-1,1] (positive half, the rule is symmetric) and weights.
+   The nodes of odd index are the nodes of the Gauss rule with 7 nodes. */
+static const double xgk[8] = {
+  0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+  0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+  0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+  0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+};
+static const double wgk[8] = {
+  0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+  0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+  0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+  0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+};
+static const double wg[4] = {
+  0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+  0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+};
+
+/* Interval of the adaptive integration, with its value and error estimate */
+typedef struct{
+  double a;
+  double b;
+  double value;
+  double error;
+} Segment;
+
+/* G7-K15 on [a,b] : 15 evaluations of f */
+static Segment kronrod15(double (*f)(double, void*), void* data, double a, double b)
+{
+  double center = (a+b)/2;
+  double half = (b-a)/2;
+  double fc = f(center, data);
+  double kronrod = wgk[7]*fc;
+  double gauss = wg[3]*fc;
+  for (int j = 0; j < 7; j++)
+  {
+    double dx = half*xgk[j];
+    double fsum = f(center-dx, data) + f(center+dx, data);
+    kronrod += wgk[j]*fsum;
+    if (j % 2 == 1)
+    {
+      gauss += wg[j/2]*fsum;
+    }
+  }
+  Segment seg = {a, b, kronrod*half, fabs((kronrod-gauss)*half)};
+  return seg;
+}
+
+/* Max-heap of segments, ordered by error */
+static void heapPush(Segment* heap, int* size, Segment seg)
+{
+  int i = (*size)++;
+  while (i > 0 && heap[(i-1)/2].error < seg.error)
+  {
+    heap[i] = heap[(i-1)/2];
+    i = (i-1)/2;
+  }
+  heap[i] = seg;
+}
+
+static Segment heapPop(Segment* heap, int* size)
+{
+  Segment top = heap[0];
+  Segment last = heap[--(*size)];
+  int i = 0;
+  for (;;)
+  {
+    int child = 2*i+1;
+    if (child >= *size)
+    {
+      break;
+    }
+    if (child+1 < *size && heap[child+1].error > heap[child].error)
+    {
+      child++;
+    }
+    if (heap[child].error <= last.error)
+    {
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  if (*size > 0)
+  {
+    heap[i] = last;
+  }
+  return top;
+}
+
+bool integrate_adaptive_r(double (*f)(double, void*), void* data, double a, double b, double epsabs, double epsrel, int maxEvals, IntegrationResult* res)
+{
+  INSTRUMENT_SCOPE("integrate_adaptive_r");
+  INSTRUMENT_INTEGRAL(0, 0);
+  int capacity = 64;
+  int size = 0;
+  Segment* heap = malloc(capacity*sizeof(Segment));
+  Segment first = kronrod15(f, data, a, b);
+  heapPush(heap, &size, first);
+  double value = first.value;
+  double error = first.error;
+  int evals = 15;
+
+  while (error > fmax(epsabs, epsrel*fabs(value)) && evals+30 <= maxEvals)
+  {
+    Segment worst = heapPop(heap, &size);
+    double middle = (worst.a+worst.b)/2;
+    if (middle == worst.a || middle == worst.b)
+    {
+      /* The interval can not be split any more */
+      heapPush(heap, &size, worst);
+      break;
+    }
+    Segment left = kronrod15(f, data, worst.a, middle);
+    Segment right = kronrod15(f, data, middle, worst.b);
+    evals += 30;
+    value += left.value + right.value - worst.value;
+    error += left.error + right.error - worst.error;
+    if (size+2 > capacity)
+    {
+      capacity *= 2;
+      heap = realloc(heap, capacity*sizeof(Segment));
+    }
+    heapPush(heap, &size, left);
+    heapPush(heap, &size, right);
+  }
+
+  /* The totals are computed again, without the rounding errors of the updates */
+  value = 0;
+  error = 0;
+  for (int i = 0; i < size; i++)
+  {
+    value += heap[i].value;
+    error += heap[i].error;
+  }
+  free(heap);
+  res->value = value;
+  res->error = error;
+  res->evals = evals;
+  INSTRUMENT_EVALS(evals/15, evals);
+  return error <= fmax(epsabs, epsrel*fabs(value));
+}
+
+bool integrate_adaptive(double (*f)(double), double a, double b, double epsabs, double epsrel, int maxEvals, IntegrationResult* res)
+{
+  Integrand integrand = {f};
+  return integrate_adaptive_r(callIntegrand, &integrand, a, b, epsabs, epsrel, maxEvals, res);
+}
+
+/* ==========================================================*/
+/* Romberg integration                                       */
+
+/* Sum of f at the middles of the N subdivisions of [a,b] */
+static double middleSum(double (*f)(double, void*), void* data, double a, double h, long N)
+{
+  double total = 0.0;
+  for (long i = 0; i < N; i++)
+  {
+    total += f(a + (i+0.5)*h, data);
+  }
+  return total;
+}
+
+bool integrate_romberg_r(double (*f)(double, void*), void* data, double a, double b, int N, double epsabs, double epsrel, int maxEvals, IntegrationResult* res)
+{
+  INSTRUMENT_SCOPE("integrate_romberg_r");
+  INSTRUMENT_INTEGRAL(0, 0);
+  /* R[j]: row k of the Romberg table, R[0] being the trapezes rule with N*2^k subdivisions */
+  double R[ROMBERG_MAX_LEVELS];
+  long n = (N < 1) ? 1 : N;
+  double h = (b-a)/n;
+  double inner = 0.0;
+  for (long i = 1; i < n; i++)
+  {
+    inner += f(a + i*h, data);
+  }
+  R[0] = h*((f(a, data) + f(b, data))/2 + inner);
+  long evals = n+1;
+  double value = R[0];
+  double error = INFINITY;
+  bool converged = false;
+
+  for (int k = 1; k < ROMBERG_MAX_LEVELS && evals + n <= maxEvals; k++)
+  {
+    /* The new nodes are the middles of the current subdivisions:
+       trapezes(2n) = (trapezes(n) + middle(n))/2 */
+    double middle = h*middleSum(f, data, a, h, n);
+    evals += n;
+    n *= 2;
+    h /= 2;
+    double previous = R[0];
+    R[0] = (R[0] + middle)/2;
+    /* Richardson extrapolation: the error of row k, column j is O(h^(2j+2)) */
+    double factor = 1.0;
+    for (int j = 1; j <= k; j++)
+    {
+      factor *= 4.0;
+      double extrapolated = R[j-1] + (R[j-1] - previous)/(factor - 1.0);
+      previous = (j < k) ? R[j] : 0.0;
+      R[j] = extrapolated;
+    }
+    error = fabs(R[k] - value);
+    value = R[k];
+    /* Two levels at least, so that a function seen only at a few points (periodic
+       integrand for instance) does not seem converged */
+    if (k >= 2 && error <= fmax(epsabs, epsrel*fabs(value)))
+    {
+      converged = true;
+      break;
+    }
+  }
+  res->value = value;
+  res->error = error;
+  res->evals = (int) evals;
+  INSTRUMENT_EVALS(n, evals);
+  return converged;
+}
+
+bool integrate_romberg(double (*f)(double), double a, double b, int N, double epsabs, double epsrel, int maxEvals, IntegrationResult* res)
+{
+  Integrand integrand = {f};
+  return integrate_romberg_r(callIntegrand, &integrand, a, b, N, epsabs, epsrel, maxEvals, res);
+}
+
+double integrate_dx_r(double (*f)(double, void*), void* data, double a, double b, IntegrationConfig* cfg)
+{
+  INSTRUMENT_SCOPE("integrate_dx_r");
+  if (cfg->adaptive)
+  {
+    IntegrationResult res;
+    integrate_adaptive_r(f, data, a, b, cfg->epsabs, cfg->epsrel, cfg->maxEvals, &res);
+    return res.value;
+  }
+  int N = nbSubdivisions(a, b, cfg->dx);
+  /* Above the threshold, the blocked sum whatever the number of threads (one thread, or
+     inside a task of the pool, computes the same blocks): the result does not depend on it */
+  if (N >= cfg->parallelThreshold)
+  {
+    return integrate_parallel_r(f, data, a, b, N, &cfg->qf, cfg->threads);
+  }
+  return integrate_r(f, data, a, b, N, &cfg->qf);
+}
+
+/* ==========================================================*/
+/* Integrands evaluated on arrays                             */
+
+/* Integral on the subdivisions first..last-1 of width sub from a, in the order of integrate_r */
+static double batchSum(BatchIntegrand f, void* data, double a, double sub, int first, int last, QuadFormula* qf)
+{
+  double x[INTEGRATION_BATCH_NODES];
+  double y[INTEGRATION_BATCH_NODES];
+  int perBlock = INTEGRATION_BATCH_NODES/qf->n; /* Subdivisions per call of f */
+  double total=0;
+  for (int start = first; start < last; start += perBlock)
+  {
+    int end = (start+perBlock < last) ? start+perBlock : last;
+    int k = 0;
+    for (int i = start; i < end; i++)
+    {
+      double ai=a+i*sub;
+      double bi=a+(i+1)*sub;
+      for (int j = 0; j < qf->n; j++)
+      {
+        x[k++] = ai+(qf->x[j]*(bi-ai));
+      }
+    }
+    f(x, y, k, data);
+    k = 0;
+    for (int i = start; i < end; i++)
+    {
+      double ai=a+i*sub;
+      double bi=a+(i+1)*sub;
+      double summ=0;
+      for (int j = 0; j < qf->n; j++)
+      {
+        summ+=(qf->w[j])*y[k++];
+      }
+      total+=(bi-ai)*summ;
+    }
+  }
+  return total;
+}
+
+double integrate_batch(BatchIntegrand f, void* data, double a, double b, int N, QuadFormula* qf)
+{
+  INSTRUMENT_SCOPE("integrate_batch");
+  INSTRUMENT_INTEGRAL(N, (long) N*qf->n);
+  return batchSum(f, data, a, (b-a)/N, 0, N, qf);
+}
+
+/* Parallel version of integrate_batch: same blocks and pairwise reduction as
+   integrate_parallel_r, each block being summed by batchSum */
+typedef struct{
+  BatchIntegrand f;
+  void* data;
+  double a;
+  double sub;
+  int N;
+  QuadFormula* qf;
+  double* blocks;
+} ParallelBatchIntegral;
+
+static void integrateBatchBlock(int block, void* arg)
+{
+  ParallelBatchIntegral* p = (ParallelBatchIntegral*) arg;
+  int first = block*INTEGRATION_BLOCK;
+  int last = (first+INTEGRATION_BLOCK < p->N) ? first+INTEGRATION_BLOCK : p->N;
+  p->blocks[block] = batchSum(p->f, p->data, p->a, p->sub, first, last, p->qf);
 }
 
+static double integrateParallelBatch(BatchIntegrand f, void* data, double a, double b, int N, QuadFormula* qf, int nthreads)
+{
+  INSTRUMENT_SCOPE("integrate_parallel_batch");
+  INSTRUMENT_INTEGRAL(N, (long) N*qf->n);
+  int nblocks = (N + INTEGRATION_BLOCK-1)/INTEGRATION_BLOCK;
+  ParallelBatchIntegral p = {f, data, a, (b-a)/N, N, qf, malloc(nblocks*sizeof(double))};
+  parallelFor((nthreads > 1) ? getThreadPool(nthreads) : NULL, nthreads, nblocks, integrateBatchBlock, &p);
+  double total = pairwiseSum(p.blocks, 0, nblocks);
+  free(p.blocks);
+  return total;
+}
 
+/* All the subdivisions have the width sub: node m of a block starting at subdivision first
+   is a + (first + offset[m])*sub, and the products w[m]*f(x) of the block are added in double
+   in one loop, then multiplied by sub (offsets and weights repeated for each subdivision) */
+double integrate_batchf(BatchIntegrandf f, void* data, double a, double b, int N, QuadFormula* qf, double* error)
+{
+  INSTRUMENT_SCOPE("integrate_batchf");
+  INSTRUMENT_INTEGRAL(N, (long) N*qf->n);
+  if (N < 1)
+  {
+    /* As integrate_batch: no subdivision, 0 (and not (b-a)/N*0) */
+    if (error != NULL)
+    {
+      *error = 0.0;
+    }
+    return 0.0;
+  }
+  float x[INTEGRATION_BATCH_NODES];
+  float y[INTEGRATION_BATCH_NODES];
+  float w[INTEGRATION_BATCH_NODES];
+  double offset[INTEGRATION_BATCH_NODES];
+  int n = qf->n;
+  int perBlock = INTEGRATION_BATCH_NODES/n;
+  for (int k = 0; k < perBlock*n; k++)
+  {
+    w[k] = (float) qf->w[k % n];
+    offset[k] = k/n + qf->x[k % n];
+  }
+  double total=0;
+  double magnitude=0; /* Sum of |w[j]*f(x)| */
+  double sub=(b-a)/N;
+  for (int first = 0; first < N; first += perBlock)
+  {
+    int last = (first+perBlock < N) ? first+perBlock : N;
+    int k = (last-first)*n;
+    for (int m = 0; m < k; m++)
+    {
+      x[m] = (float) (a+(first+offset[m])*sub);
+    }
+    f(x, y, k, data);
+    double sum=0;
+    double abssum=0;
+    for (int m = 0; m < k; m++)
+    {
+      float wy = w[m]*y[m];
+      sum += wy;
+      abssum += fabsf(wy);
+    }
+    total+=sum;
+    magnitude+=abssum;
+  }
+  if (error != NULL)
+  {
+    *error = (n+4)*(FLT_EPSILON/2)*fabs(sub)*magnitude;
+  }
+  return sub*total;
+}
+
+/* Batch integrand called with one node, for the adaptive integration */
+typedef struct{
+  BatchIntegrand f;
+  void* data;
+} BatchAdapter;
+
+static double callBatchIntegrand(double x, void* data)
+{
+  BatchAdapter* adapter = (BatchAdapter*) data;
+  double y;
+  adapter->f(&x, &y, 1, adapter->data);
+  return y;
+}
+
+double integrate_dx_batch(BatchIntegrand f, void* data, double a, double b, IntegrationConfig* cfg)
+{
+  if (cfg->adaptive)
+  {
+    BatchAdapter adapter = {f, data};
+    IntegrationResult res;
+    integrate_adaptive_r(callBatchIntegrand, &adapter, a, b, cfg->epsabs, cfg->epsrel, cfg->maxEvals, &res);
+    return res.value;
+  }
+  int N = nbSubdivisions(a, b, cfg->dx);
+  if (N >= cfg->parallelThreshold)
+  {
+    return integrateParallelBatch(f, data, a, b, N, &cfg->qf, cfg->threads);
+  }
+  return integrate_batch(f, data, a, b, N, &cfg->qf);
+}
+
+/* ==========================================================*/
+/* Running integral at sorted abscissae                       */
+
+bool integrate_cumulative_r(double (*f)(double, void*), void* data, double a, double* xs, int k, IntegrationConfig* cfg, double* out)
+{
+  INSTRUMENT_SCOPE("integrate_cumulative_r");
+  INSTRUMENT_INTEGRAL(0, 0);
+  if (!isfinite(a))
+  {
+    return false;
+  }
+  for (int j = 0; j < k; j++)
+  {
+    if (!isfinite(xs[j]) || (j > 0 && xs[j] < xs[j-1]))
+    {
+      return false;
+    }
+  }
+
+  if (cfg->adaptive)
+  {
+    double total = 0;  /* Integral from a to the previous abscissa */
+    double previous = a;
+    for (int j = 0; j < k; j++)
+    {
+      if (xs[j] <= a)
+      {
+        out[j] = (xs[j] < a) ? integrate_dx_r(f, data, a, xs[j], cfg) : 0.0;
+        continue;
+      }
+      total += integrate_dx_r(f, data, previous, xs[j], cfg);
+      previous = xs[j];
+      out[j] = total;
+    }
+    return true;
+  }
+
+  double dx = cfg->dx;
+  if (!(dx > 0))
+  {
+    return false; /* The subdivisions would never reach xs[j] */
+  }
+  double total = 0;  /* Integral from a to a+i*dx */
+  long i = 0;        /* (xs[j]-a)/dx can exceed INT_MAX */
+  for (int j = 0; j < k; j++)
+  {
+    double x = xs[j];
+    if (x <= a)
+    {
+      out[j] = (x < a) ? integrate_dx_r(f, data, a, x, cfg) : 0.0;
+      continue;
+    }
+    while (a+(i+1)*dx <= x)
+    {
+      double ai=a+i*dx;
+      double bi=a+(i+1)*dx;
+      total+=(bi-ai)*sum_r(f, data, ai, bi, &cfg->qf);
+      i++;
+    }
+    double ai=a+i*dx;
+    out[j] = total;
+    if (x > ai)
+    {
+      out[j]+=(x-ai)*sum_r(f, data, ai, x, &cfg->qf);
+      INSTRUMENT_EVALS(1, cfg->qf.n);
+    }
+  }
+  INSTRUMENT_EVALS(i, (long) i*cfg->qf.n);
+  return true;
+}
+
+bool integrate_cumulative(double (*f)(double), double a, double* xs, int k, double dx, QuadFormula* qf, double* out)
+{
+  Integrand integrand = {f};
+  IntegrationConfig cfg;
+  cfg.qf = *qf;
+  cfg.dx = dx;
+  cfg.threads = 1;
+  cfg.parallelThreshold = 0;
+  cfg.adaptive = false;
+  return integrate_cumulative_r(callIntegrand, &integrand, a, xs, k, &cfg, out);
+}
@@ -13,6 +13,13 @@
 #ifndef INTEGRATION_H
 #define INTEGRATION_H
 
+/* Handle of a quadrature formula, returned by findQuadRule: an index in the table of the
+   formulas, which replaces the comparisons of names. */
+typedef int QuadRule;
+
+/* Maximal number of nodes of the formulas "gaussN", "lobattoN" and "clenshawN" */
+#define QUAD_MAX_NODES 128
+
 /* Represents a quadrature formula.
    The function integrate takes an argument of type QuadFormula *.
    Have everything in this structure that will be needed by the function integrate.
@@ -20,12 +27,51 @@
 typedef struct{
   char name[20]; /* Name of the quadrature formula. */
                  /* (possible value: "left", "right", "middle", "trapezes", "simpson", "gauss2" or "gauss3") */
+                 /* or "gaussN", "lobattoN", "clenshawN" with N nodes, N <= QUAD_MAX_NODES */
   /* Add here other paramaters to the structure definition, that you may need for the integral function */
 int n;
-double x[3];
-double w[3];
+double* x; /* n nodes in [0,1], in increasing order (tables shared by all the QuadFormula) */
+double* w; /* n weights, of sum 1 */
+QuadRule rule;
 } QuadFormula;
 
+/* Integration parameters given explicitly to the reentrant functions (suffix _r).
+   Nothing is read from global variables, so several threads can integrate at the
+   same time, each one with its own IntegrationConfig (or sharing a read-only one).
+*/
+typedef struct{
+  QuadFormula qf; /* Quadrature formula used on each subdivision */
+  double dx;      /* Target length of a subdivision: N = |b-a|/dx */
+  int threads;    /* Number of threads used by integrate_dx_r (1: sequential) */
+  int parallelThreshold; /* integrate_dx_r stays sequential when N < parallelThreshold */
+  bool adaptive;  /* integrate_dx_r uses integrate_adaptive_r instead of qf and dx */
+  double epsabs;  /* Tolerances and maximal number of evaluations of the adaptive mode */
+  double epsrel;
+  int maxEvals;
+} IntegrationConfig;
+
+/* Result of an integration which estimates its own error */
+typedef struct{
+  double value;
+  double error;  /* Estimation of |value - exact integral| */
+  int evals;     /* Number of evaluations of the integrand */
+} IntegrationResult;
+
+/* Number of consecutive subdivisions summed sequentially by one task of integrate_parallel */
+#define INTEGRATION_BLOCK 256
+
+/* Integrand evaluated on an array of abscissae: y[i] = f(x[i]) for i = 0..n-1.
+   data is the pointer given to the integration function, as for integrate_r.
+   The integration functions never call it with n > INTEGRATION_BATCH_NODES. */
+typedef void (*BatchIntegrand)(double* x, double* y, size_t n, void* data);
+#define INTEGRATION_BATCH_NODES 1024
+
+/* Single precision integrand for integrate_batchf, same contract as BatchIntegrand */
+typedef void (*BatchIntegrandf)(float* x, float* y, size_t n, void* data);
+
+/* Maximal number of levels of integrate_romberg (N*2^(ROMBERG_MAX_LEVELS-1) subdivisions) */
+#define ROMBERG_MAX_LEVELS 30
+
 #ifdef INTEGRATION_C
 
 #else /* INTEGRATION_C */
@@ -35,6 +81,17 @@ double w[3];
 extern bool setQuadFormula(QuadFormula* qf, char* name);
 extern void printQuadFormula(QuadFormula* qf); /* Not required but useful for debugging */
 
+/* Formulas with any number of nodes, in addition to the 7 formulas above:
+   - "gaussN" (1 <= N <= QUAD_MAX_NODES) : Gauss-Legendre, exact for polynomials of degree 2N-1
+   - "lobattoN" (2 <= N) : Gauss-Lobatto, with both ends as nodes, exact up to degree 2N-3
+   - "clenshawN" (2 <= N) : Clenshaw-Curtis, nodes cos(k*pi/(N-1)), exact up to degree N-1
+   findQuadRule returns the handle of a formula from its name, or -1 if the name is unknown
+   (or if the memory of its table is missing).
+   The nodes and weights are computed by the first call for this formula (thread-safe), and
+   kept for the next ones. setQuadRule then fills qf without any comparison of strings. */
+extern QuadRule findQuadRule(char* name);
+extern bool setQuadRule(QuadFormula* qf, QuadRule rule);
+
 /* Returns the integral of function f from a to b. The approximation is done by splitting
    the interval [a,b] in N subdivisions, and then using the quadrature formula defined by qf */
 extern double integrate(double (*f)(double), double a, double b, int N, QuadFormula* qf);
@@ -43,6 +100,85 @@ extern double integrate(double (*f)(double), double a, double b, int N, QuadForm
    argument dx: we take N = |b-a|/dx (rounded to be an integer) */
 extern double integrate_dx(double (*f)(double), double a, double b, double dx, QuadFormula* qf);
 
+/* Reentrant versions of integrate and integrate_dx.
+   The integrand receives, in addition to the abscissa, the pointer data given by the caller.
+   This replaces the static variables otherwise needed to pass parameters to f.
+   setIntegrationConfig also accepts the name "adaptive": dx is then the tolerance
+   (epsabs = epsrel = dx) and integrate_dx_r calls integrate_adaptive_r. */
+extern bool setIntegrationConfig(IntegrationConfig* cfg, char* quadrature, double dx);
+extern double integrate_r(double (*f)(double, void*), void* data, double a, double b, int N, QuadFormula* qf);
+extern double integrate_dx_r(double (*f)(double, void*), void* data, double a, double b, IntegrationConfig* cfg);
+
+/* Same as integrate_r and integrate_dx_r, with an integrand evaluated on arrays.
+   The nodes of as many consecutive subdivisions as possible (up to INTEGRATION_BATCH_NODES
+   nodes) are stored in one array, and f is called once for all of them: f can then use
+   vector instructions, and there is one indirect call per block instead of one per node.
+   The sums are done in the same order as integrate_r.
+   integrate_dx_batch uses cfg->threads as integrate_dx_r: above cfg->parallelThreshold
+   subdivisions, the same blocks as integrate_parallel_r are computed, by several threads
+   if cfg->threads > 1 (f must then be reentrant). In adaptive mode f is called with one node at a time. */
+extern double integrate_batch(BatchIntegrand f, void* data, double a, double b, int N, QuadFormula* qf);
+extern double integrate_dx_batch(BatchIntegrand f, void* data, double a, double b, IntegrationConfig* cfg);
+
+/* integrate_batch with a float integrand (twice as many values per vector instruction).
+   The nodes are computed in double and rounded to float, the products w[j]*f(x) are done in
+   float and added in double, so that the rounding errors do not grow with N. If error is
+   not NULL, *error is an estimate of |result - integrate_batch with the same integrand in
+   double|: the rounding of the float values, (n+4)*u*sum of |(bi-ai)*w[j]*f(x)|
+   (u: unit roundoff of float). */
+extern double integrate_batchf(BatchIntegrandf f, void* data, double a, double b, int N, QuadFormula* qf, double* error);
+
+/* Parallel version of integrate_r.
+   The N subdivisions are grouped in blocks of INTEGRATION_BLOCK subdivisions, whose integrals
+   are computed by up to nthreads threads (threadpool.h). The integrals of the blocks are then
+   added in a fixed pairwise tree: the result is the same, bit for bit, whatever nthreads
+   (it can differ from integrate_r by rounding errors). f must be reentrant. */
+extern double integrate_parallel(double (*f)(double), double a, double b, int N, QuadFormula* qf, int nthreads);
+extern double integrate_parallel_r(double (*f)(double, void*), void* data, double a, double b, int N, QuadFormula* qf, int nthreads);
+
+/* Makes integrate_dx_r use integrate_parallel_r with nthreads threads when N >= threshold
+   (setIntegrationConfig selects 1 thread, threshold 16*INTEGRATION_BLOCK). Above the
+   threshold, the blocked sum of integrate_parallel_r is used whatever nthreads (even 1):
+   the result of integrate_dx_r does not depend on the number of threads, bit for bit.
+   Below it, integrate_dx_r is integrate_r. Returns false if nthreads < 1. */
+extern bool setIntegrationThreads(IntegrationConfig* cfg, int nthreads, int threshold);
+
+/* Adaptive Gauss-Kronrod integration of f from a to b.
+   On each interval, the Kronrod rule with 15 nodes gives the value, and its difference with
+   the Gauss rule with 7 nodes (nested in the 15 nodes) gives the error estimate.
+   The interval with the largest error (kept in a priority queue) is split in two, until the
+   total error is <= max(epsabs, epsrel*|value|) or until maxEvals evaluations have been done.
+   Returns true if the tolerance has been reached. res gets the value, error and evals. */
+extern bool integrate_adaptive(double (*f)(double), double a, double b, double epsabs, double epsrel, int maxEvals, IntegrationResult* res);
+extern bool integrate_adaptive_r(double (*f)(double, void*), void* data, double a, double b, double epsabs, double epsrel, int maxEvals, IntegrationResult* res);
+
+/* Makes integrate_dx_r use integrate_adaptive_r with these parameters */
+extern bool setIntegrationTolerance(IntegrationConfig* cfg, double epsabs, double epsrel, int maxEvals);
+
+/* Romberg integration of f from a to b, starting with the trapezes rule on N subdivisions.
+   Each level doubles the number of subdivisions: only the middles of the current ones are
+   evaluated (trapezes(2N) = (trapezes(N) + middle(N))/2), all the previous evaluations are
+   kept. The Richardson extrapolation of the trapezes values of all the levels removes the
+   terms in h^2, h^4, ... of the error (f smooth enough). It stops when two successive
+   extrapolated values differ by at most max(epsabs, epsrel*|value|) (after 2 levels at
+   least), or before exceeding maxEvals evaluations. The cost is about N*2^k + 1
+   evaluations for k levels: the same as the trapezes rule at the finest level alone.
+   Returns true if the tolerance has been reached. res gets the value, the difference of
+   the last two values (error) and evals. */
+extern bool integrate_romberg(double (*f)(double), double a, double b, int N, double epsabs, double epsrel, int maxEvals, IntegrationResult* res);
+extern bool integrate_romberg_r(double (*f)(double, void*), void* data, double a, double b, int N, double epsabs, double epsrel, int maxEvals, IntegrationResult* res);
+
+/* Running integral: out[j] = integral of f from a to xs[j], for j = 0..k-1.
+   a and the values xs must be finite, xs sorted in increasing order, and dx > 0 except in
+   adaptive mode (otherwise false is returned).
+   All the integrals are computed in one pass over the subdivisions [a+i*dx, a+(i+1)*dx]:
+   out[j] is the sum over the subdivisions before xs[j], plus the integral on the last,
+   incomplete, subdivision. The cost is hence O(N + k) instead of O(k*N).
+   Values xs[j] < a are integrated separately (from a down to xs[j]).
+   In adaptive mode, the integral between two consecutive abscissae is an adaptive integral. */
+extern bool integrate_cumulative(double (*f)(double), double a, double* xs, int k, double dx, QuadFormula* qf, double* out);
+extern bool integrate_cumulative_r(double (*f)(double, void*), void* data, double a, double* xs, int k, IntegrationConfig* cfg, double* out);
+
 #endif /* INTEGRATION_C */
 
 #endif /* INTEGRATION_H */
\ No newline at end of file
@@ -0,0 +1,330 @@
+#define MONTECARLO_C
+
+#include "montecarlo.h"
+#include "vecmath.h"
+#include "threadpool.h"
+
+/* ==========================================================*/
+/* Philox4x32-10                                             */
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+void philox4x32(uint32_t counter[4], uint32_t key[2], uint32_t out[4])
+{
+  uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; round++)
+  {
+    uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+    uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+    uint32_t hi0 = (uint32_t) (p0 >> 32), lo0 = (uint32_t) p0;
+    uint32_t hi1 = (uint32_t) (p1 >> 32), lo1 = (uint32_t) p1;
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/* Uniform in ]0,1[ from 64 random bits: 53 bits, shifted by half an ulp (never 0 or 1) */
+static double uniform(uint32_t hi, uint32_t lo)
+{
+  uint64_t bits = (((uint64_t) hi << 32) | lo) >> 11;
+  return (bits + 0.5) * (1.0/9007199254740992.0);
+}
+
+/* Streams: the last word of the counter separates the uses of the random numbers */
+#define MC_STREAM_NORMALS 0
+#define MC_STREAM_NORMALS2 1
+#define MC_STREAM_UNIFORMS 2
+
+/* z[i] ~ N(0,1) for i = 0..n-1, i-th of the block: two normal variables (Box-Muller) for
+   each counter (i/2, block, stream) */
+static void normals(McConfig* mc, long block, uint32_t stream, double* z, int n)
+{
+  uint32_t key[2] = {(uint32_t) mc->seed, (uint32_t) (mc->seed >> 32)};
+  for (int i = 0; i < n; i += 2)
+  {
+    uint32_t counter[4] = {(uint32_t) (i/2), (uint32_t) block, (uint32_t) ((uint64_t) block >> 32), stream};
+    uint32_t r[4];
+    philox4x32(counter, key, r);
+    double radius = sqrt(-2.0*log(uniform(r[0], r[1])));
+    double angle = 2.0*M_PI*uniform(r[2], r[3]);
+    z[i] = radius*cos(angle);
+    if (i+1 < n)
+    {
+      z[i+1] = radius*sin(angle);
+    }
+  }
+}
+
+/* u[i] uniform in ]0,1[, two for each counter (i/2, block, stream) */
+static void uniforms(McConfig* mc, long block, uint32_t stream, double* u, int n)
+{
+  uint32_t key[2] = {(uint32_t) mc->seed, (uint32_t) (mc->seed >> 32)};
+  for (int i = 0; i < n; i += 2)
+  {
+    uint32_t counter[4] = {(uint32_t) (i/2), (uint32_t) block, (uint32_t) ((uint64_t) block >> 32), stream};
+    uint32_t r[4];
+    philox4x32(counter, key, r);
+    u[i] = uniform(r[0], r[1]);
+    if (i+1 < n)
+    {
+      u[i+1] = uniform(r[2], r[3]);
+    }
+  }
+}
+
+void initMcConfig(McConfig* mc, long paths, uint64_t seed)
+{
+  mc->paths = paths;
+  mc->seed = seed;
+  mc->antithetic = true;
+  mc->controlVariate = true;
+  mc->threads = 1;
+}
+
+/* ==========================================================*/
+/* Estimation                                                */
+
+/* Means and centred co-moments of the samples (Y, C) : Y is estimated, C is the control */
+typedef struct{
+  long n;
+  double meanY;
+  double meanC;
+  double Myy;
+  double Mcc;
+  double Myc;
+} Moments;
+
+/* Moments of the n samples y[i], c[i] (two passes) */
+static Moments moments(double* y, double* c, int n)
+{
+  Moments m = {n, 0.0, 0.0, 0.0, 0.0, 0.0};
+  for (int i = 0; i < n; i++)
+  {
+    m.meanY += y[i];
+    m.meanC += c[i];
+  }
+  m.meanY /= n;
+  m.meanC /= n;
+  for (int i = 0; i < n; i++)
+  {
+    double dy = y[i] - m.meanY, dc = c[i] - m.meanC;
+    m.Myy += dy*dy;
+    m.Mcc += dc*dc;
+    m.Myc += dy*dc;
+  }
+  return m;
+}
+
+/* Moments of the union of the samples of a and b (Chan et al.) */
+static Moments mergeMoments(Moments a, Moments b)
+{
+  if (a.n == 0) return b;
+  if (b.n == 0) return a;
+  Moments m;
+  m.n = a.n + b.n;
+  double dy = b.meanY - a.meanY, dc = b.meanC - a.meanC;
+  double f = (double) a.n * b.n / m.n;
+  m.meanY = a.meanY + dy*b.n/m.n;
+  m.meanC = a.meanC + dc*b.n/m.n;
+  m.Myy = a.Myy + b.Myy + dy*dy*f;
+  m.Mcc = a.Mcc + b.Mcc + dc*dc*f;
+  m.Myc = a.Myc + b.Myc + dy*dc*f;
+  return m;
+}
+
+typedef struct{
+  McConfig* mc;
+  Option* option;
+  InsuredClient* client;
+  double x;
+  long samples;     /* Number of samples (pairs of paths with antithetic) */
+  Moments* blocks;  /* Moments of each block */
+  bool failed;
+} MonteCarlo;
+
+/* Samples of the block of the option: payoff and S_T, averaged on the pairs Z, -Z */
+static void optionSamples(MonteCarlo* mcarlo, long block, int n, double* scratch, double* y, double* c)
+{
+  Option* opt = mcarlo->option;
+  double* z = scratch;
+  double* st = scratch + MC_BLOCK;
+  double center = log(opt->S0) + (opt->mu - opt->sig*opt->sig/2)*opt->T;
+  double vol = opt->sig*sqrt(opt->T);
+  double sgn = (opt->type == CALL) ? 1.0 : -1.0;
+  normals(mcarlo->mc, block, MC_STREAM_NORMALS, z, n);
+  int sides = mcarlo->mc->antithetic ? 2 : 1;
+  for (int i = 0; i < n; i++)
+  {
+    y[i] = 0.0;
+    c[i] = 0.0;
+  }
+  for (int side = 0; side < sides; side++)
+  {
+    double v = (side == 0) ? vol : -vol;
+    for (int i = 0; i < n; i++)
+    {
+      st[i] = center + v*z[i];
+    }
+    vecExp(st, st, n);
+    for (int i = 0; i < n; i++)
+    {
+      double payoff = sgn*(st[i] - opt->K);
+      y[i] += (payoff > 0.0) ? payoff : 0.0;
+      c[i] += st[i];
+    }
+  }
+  for (int i = 0; i < n && sides == 2; i++)
+  {
+    y[i] *= 0.5;
+    c[i] *= 0.5;
+  }
+}
+
+/* Samples of the block of the client: 1{S <= x} and 1{N >= 1, X1 <= x} */
+static void claimSamples(MonteCarlo* mcarlo, long block, int n, double* scratch, double* y, double* c)
+{
+  InsuredClient* client = mcarlo->client;
+  double* z1 = scratch;
+  double* z2 = scratch + MC_BLOCK;
+  double* u = scratch + 2*MC_BLOCK;
+  double* x1 = scratch + 3*MC_BLOCK;
+  double* x2 = scratch + 4*MC_BLOCK;
+  normals(mcarlo->mc, block, MC_STREAM_NORMALS, z1, n);
+  normals(mcarlo->mc, block, MC_STREAM_NORMALS2, z2, n);
+  uniforms(mcarlo->mc, block, MC_STREAM_UNIFORMS, u, n);
+  int sides = mcarlo->mc->antithetic ? 2 : 1;
+  for (int i = 0; i < n; i++)
+  {
+    y[i] = 0.0;
+    c[i] = 0.0;
+  }
+  for (int side = 0; side < sides; side++)
+  {
+    double s = (side == 0) ? client->s : -client->s;
+    for (int i = 0; i < n; i++)
+    {
+      x1[i] = client->m + s*z1[i];
+      x2[i] = client->m + s*z2[i];
+    }
+    vecExp(x1, x1, n);
+    vecExp(x2, x2, n);
+    for (int i = 0; i < n; i++)
+    {
+      double ui = (side == 0) ? u[i] : 1.0 - u[i];
+      int claims = (ui < client->p[0]) ? 0 : ((ui < client->p[0] + client->p[1]) ? 1 : 2);
+      double S = (claims >= 1 ? x1[i] : 0.0) + (claims == 2 ? x2[i] : 0.0);
+      y[i] += (S <= mcarlo->x) ? 1.0 : 0.0;
+      c[i] += (claims >= 1 && x1[i] <= mcarlo->x) ? 1.0 : 0.0;
+    }
+  }
+  for (int i = 0; i < n && sides == 2; i++)
+  {
+    y[i] *= 0.5;
+    c[i] *= 0.5;
+  }
+}
+
+/* Task of a block: its samples, then their moments */
+static void mcBlock(int block, void* data)
+{
+  MonteCarlo* mcarlo = (MonteCarlo*) data;
+  long first = (long) block * MC_BLOCK;
+  int n = (mcarlo->samples - first < MC_BLOCK) ? (int) (mcarlo->samples - first) : MC_BLOCK;
+  double* scratch = malloc(7 * MC_BLOCK * sizeof(double));
+  if (scratch == NULL)
+  {
+    mcarlo->failed = true;
+    return;
+  }
+  double* y = scratch + 5*MC_BLOCK;
+  double* c = scratch + 6*MC_BLOCK;
+  if (mcarlo->option != NULL)
+  {
+    optionSamples(mcarlo, block, n, scratch, y, c);
+  }
+  else
+  {
+    claimSamples(mcarlo, block, n, scratch, y, c);
+  }
+  mcarlo->blocks[block] = moments(y, c, n);
+  free(scratch);
+}
+
+/* Simulates all the blocks, merges their moments in the order of the blocks, and applies
+   the control variate of expectation EC */
+static bool simulate(MonteCarlo* mcarlo, double EC, McResult* res)
+{
+  McConfig* mc = mcarlo->mc;
+  mcarlo->samples = mc->antithetic ? (mc->paths + 1)/2 : mc->paths;
+  long nblocks = (mcarlo->samples + MC_BLOCK - 1)/MC_BLOCK;
+  if (nblocks > INT32_MAX)
+  {
+    return false;
+  }
+  mcarlo->blocks = malloc(nblocks * sizeof(Moments));
+  mcarlo->failed = (mcarlo->blocks == NULL);
+  if (!mcarlo->failed)
+  {
+    int threads = (mc->threads < 1) ? 1 : mc->threads;
+    parallelFor(getThreadPool(threads), threads, (int) nblocks, mcBlock, mcarlo);
+  }
+  if (mcarlo->failed)
+  {
+    free(mcarlo->blocks);
+    return false;
+  }
+  Moments m = {0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  for (long b = 0; b < nblocks; b++)
+  {
+    m = mergeMoments(m, mcarlo->blocks[b]);
+  }
+  free(mcarlo->blocks);
+
+  res->paths = mc->antithetic ? 2*m.n : m.n;
+  if (mc->controlVariate && m.Mcc > 0 && m.n > 2)
+  {
+    double beta = m.Myc/m.Mcc;
+    res->value = m.meanY - beta*(m.meanC - EC);
+    double variance = (m.Myy - beta*m.Myc)/(m.n - 2);
+    res->stdError = sqrt(((variance > 0) ? variance : 0.0)/m.n);
+  }
+  else
+  {
+    res->value = m.meanY;
+    res->stdError = (m.n > 1) ? sqrt(m.Myy/(m.n - 1)/m.n) : INFINITY;
+  }
+  return true;
+}
+
+bool mcOptionPrice(Option* opt, McConfig* mc, McResult* res)
+{
+  if (opt == NULL || mc == NULL || res == NULL || mc->paths < 1 || opt->S0 <= 0 || opt->T < 0 || opt->sig < 0)
+  {
+    return false;
+  }
+  MonteCarlo mcarlo = {mc, opt, NULL, 0.0, 0, NULL, false};
+  return simulate(&mcarlo, opt->S0*exp(opt->mu*opt->T), res);
+}
+
+bool mcClientCDF_S(InsuredClient* client, double x, McConfig* mc, McResult* res)
+{
+  if (client == NULL || mc == NULL || res == NULL || mc->paths < 1)
+  {
+    return false;
+  }
+  MonteCarlo mcarlo = {mc, NULL, client, x, 0, NULL, false};
+  double FX = (x > 0) ? 0.5*erfc(-(log(x) - client->m)/(client->s*1.4142135623730951)) : 0.0;
+  return simulate(&mcarlo, (1.0 - client->p[0])*FX, res);
+}
@@ -0,0 +1,64 @@
+/*************************************/
+/* Header file montecarlo.h          */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "pfa.h"
+
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+/* Number of paths simulated by one task. Path j of block b always uses the same random
+   numbers, whatever the number of threads: the results are reproducible bit for bit. */
+#define MC_BLOCK 4096
+
+/* Parameters of a Monte Carlo estimation */
+typedef struct{
+  long paths;          /* Number of simulated paths (rounded up to an even number with antithetic) */
+  uint64_t seed;       /* Key of the random generator: one independent stream per seed */
+  bool antithetic;     /* Paths by pairs, with the normal variables Z and -Z (and uniforms U and 1-U) */
+  bool controlVariate; /* Correction by a control variable of known expectation (see below) */
+  int threads;         /* Number of threads simulating the blocks (threadpool.h) */
+} McConfig;
+
+/* Result of a Monte Carlo estimation */
+typedef struct{
+  double value;
+  double stdError;     /* Standard error of value (standard deviation of the estimator) */
+  long paths;          /* Number of paths actually simulated */
+} McResult;
+
+#ifdef MONTECARLO_C
+
+#else /* MONTECARLO_C */
+
+/* Philox4x32-10 counter-based generator (Salmon et al., Random123): out is a bijective,
+   well mixed function of the 128 bits of counter, for the 64 bits of key.
+   Different counters give independent random numbers: no state is shared between threads. */
+extern void philox4x32(uint32_t counter[4], uint32_t key[2], uint32_t out[4]);
+
+/* paths paths and the given seed, antithetic and control variate on, 1 thread */
+extern void initMcConfig(McConfig* mc, long paths, uint64_t seed);
+
+/* Price of the option (same definition as optionPrice) estimated by simulating
+   S_T = S0*exp((mu - sig^2/2)*T + sig*sqrt(T)*Z), Z ~ N(0,1).
+   The control variable is S_T, of expectation S0*exp(mu*T).
+   Returns false on an invalid argument. */
+extern bool mcOptionPrice(Option* opt, McConfig* mc, McResult* res);
+
+/* clientCDF_S(client, x) estimated by simulating the number of claims N (0, 1 or 2 with
+   probabilities p) and the reimbursements X1, X2 (log-normal).
+   The control variable is 1{N >= 1 and X1 <= x}, of expectation (1-p[0])*FX(x).
+   Returns false on an invalid argument. */
+extern bool mcClientCDF_S(InsuredClient* client, double x, McConfig* mc, McResult* res);
+
+#endif /* MONTECARLO_C */
+
+#endif /* MONTECARLO_H */
@@ -3,8 +3,13 @@
 // #define GRAPHIC
 
 #define PFA_C
+#include <stdint.h>
+#include <float.h>
+#include <pthread.h>
 #include "integration.h"
 #include "pfa.h"
+#include "vecmath.h"
+#include "instrument.h"
 
 /* Initialize the integration variables.
    Arguments :
@@ -13,11 +18,25 @@
    - dt : a positive value, which will be used to decide the number of subdivisions of an 
           interval [a,b], when computing the integration.
           The number of subdivisions will be N such that (b-a)/N ~ dt
+   With quadrature = "adaptive", the integrals are computed by integrate_adaptive_r
+   (Gauss-Kronrod), and dt is the tolerance (absolute and relative) instead of a length.
 */
+bool init_integration_r(PfaConfig* cfg, char* quadrature, double dt)
+{
+  if (cfg == NULL)
+  {
+    return false;
+  }
+  cfg->phiMethod = PHI_QUADRATURE;
+  cfg->severityGrid = false;
+  return setIntegrationConfig(&cfg->integ, quadrature, dt);
+}
+
 bool init_integration(char* quadrature, double dt)
 {
   pfa_dt=dt;
-  return setQuadFormula(&pfaQF,quadrature);
+  setQuadFormula(&pfaQF,quadrature);
+  return init_integration_r(&pfaConfig, quadrature, dt);
 }
 
 
@@ -26,28 +45,185 @@ bool init_integration(char* quadrature, double dt)
 /* Density of the normal distribution */
 double phi(double x)
 {
+  INSTRUMENT_PHI(1);
   return 0.398942280401433 * exp( -x*x/2 );
 }
 
+void phi_batch(double* x, double* y, size_t n)
+{
+  INSTRUMENT_PHI(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    y[i] = -x[i]*x[i]/2;
+  }
+  vecExp(y, y, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    y[i] *= 0.398942280401433;
+  }
+}
+
+void phi_batchf(float* x, float* y, size_t n)
+{
+  INSTRUMENT_PHI(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    y[i] = -x[i]*x[i]/2;
+  }
+  vecExpf(y, y, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    y[i] *= 0.398942280f;
+  }
+}
+
+/* phi with the signatures expected by integrate_dx_r and integrate_dx_batch */
+static double localPhi(double x, void* data)
+{
+  (void) data;
+  return phi(x);
+}
+
+static void localPhiBatch(double* x, double* y, size_t n, void* data)
+{
+  (void) data;
+  phi_batch(x, y, n);
+}
+
+static double PHI_erfc(double x)
+{
+  return 0.5*erfc(-x*0.707106781186547524);
+}
+
+bool init_phi_r(PfaConfig* cfg, char* method)
+{
+  if (cfg == NULL || method == NULL)
+  {
+    return false;
+  }
+  if (strcmp(method, "quadrature") == 0)
+  {
+    cfg->phiMethod = PHI_QUADRATURE;
+  }
+  else if (strcmp(method, "erfc") == 0)
+  {
+    cfg->phiMethod = PHI_ERFC;
+  }
+  else if (strcmp(method, "table") == 0)
+  {
+    initPhiTable();
+    cfg->phiMethod = PHI_TABLE;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+bool init_phi(char* method)
+{
+  return init_phi_r(&pfaConfig, method);
+}
+
 /* Cumulative distribution function of the normal distribution */
+double PHI_r(double x, PfaConfig* cfg)
+{
+  INSTRUMENT_CDF(1);
+  switch (cfg->phiMethod)
+  {
+    case PHI_ERFC:
+      return PHI_erfc(x);
+    case PHI_TABLE:
+      return tablePHI(x);
+    default:
+      return (1.0/2.0)+integrate_dx_batch(localPhiBatch, NULL, 0, x, &cfg->integ);
+  }
+}
+
 double PHI(double x)
 {
-  return (1.0/2.0)+integrate_dx(phi, 0, x, pfa_dt, &pfaQF);
+  return PHI_r(x, &pfaConfig);
+}
+
+/* Thresholds of the curves: finite and sorted in increasing order */
+static bool validThresholds(double* xs, int k)
+{
+  for (int j = 0; j < k; j++)
+  {
+    if (!isfinite(xs[j]) || (j > 0 && xs[j] < xs[j-1]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* With the quadrature method, 0 is inserted at its place among the thresholds, so that
+   a single running integral from min(xs[0], 0) gives PHI(xs[j]) = 0.5 + I(xs[j]) - I(0).
+*/
+bool PHI_curve_r(double* xs, int k, double* out, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("PHI_curve_r");
+  INSTRUMENT_CDF(k);
+  if (!validThresholds(xs, k))
+  {
+    return false;
+  }
+  if (cfg->phiMethod != PHI_QUADRATURE)
+  {
+    for (int j = 0; j < k; j++)
+    {
+      out[j] = PHI_r(xs[j], cfg);
+    }
+    return true;
+  }
+  if (k <= 0)
+  {
+    return true;
+  }
+
+  double* ys = malloc((k+1) * sizeof(double));
+  double* integrals = malloc((k+1) * sizeof(double));
+  int zero = 0; /* Index of 0 in ys */
+  while (zero < k && xs[zero] < 0)
+  {
+    zero++;
+  }
+  memcpy(ys, xs, zero * sizeof(double));
+  ys[zero] = 0.0;
+  memcpy(ys + zero + 1, xs + zero, (k - zero) * sizeof(double));
+
+  integrate_cumulative_r(localPhi, NULL, ys[0], ys, k+1, &cfg->integ, integrals);
+  for (int j = 0; j < k; j++)
+  {
+    int y = (j < zero) ? j : j+1;
+    out[j] = (1.0/2.0) + integrals[y] - integrals[zero];
+  }
+  free(ys);
+  free(integrals);
+  return true;
+}
+
+bool PHI_curve(double* xs, int k, double* out)
+{
+  return PHI_curve_r(xs, k, out, &pfaConfig);
 }
 
 /* =====================================
    Finance function: price of an option 
 */
-double call(double z0,double S0, double K,double mu,double sig, double T)
+double call(double z0,double S0, double K,double mu,double sig, double T, PfaConfig* cfg)
 {
-  return S0*exp(mu*T)*PHI(sig*sqrt(T)-z0)-K*PHI(-1*z0);
+  return S0*exp(mu*T)*PHI_r(sig*sqrt(T)-z0, cfg)-K*PHI_r(-1*z0, cfg);
 }
-double put(double z0,double S0, double K,double mu,double sig, double T)
+double put(double z0,double S0, double K,double mu,double sig, double T, PfaConfig* cfg)
 {
-  return K*PHI(z0)-S0* exp(mu*T)*PHI(z0- (sig*sqrt(T)));
+  return K*PHI_r(z0, cfg)-S0* exp(mu*T)*PHI_r(z0- (sig*sqrt(T)), cfg);
 }
-double optionPrice(Option* option)
+double optionPrice_r(Option* option, PfaConfig* cfg)
 {
+  INSTRUMENT_SCOPE("optionPrice_r");
   if (option==NULL)
   {
     return 0.0;
@@ -56,14 +232,426 @@ double optionPrice(Option* option)
   // printf("z0 = %.5f\n", z0);
   if (option->type==0)
   {
-    return call(z0, option->S0, option->K, option->mu, option->sig, option->T);
+    return call(z0, option->S0, option->K, option->mu, option->sig, option->T, cfg);
   }
   else
   {
-    return put(z0, option->S0, option->K, option->mu, option->sig, option->T);
+    return put(z0, option->S0, option->K, option->mu, option->sig, option->T, cfg);
+  }
+}
+
+double optionPrice(Option* option)
+{
+  return optionPrice_r(option, &pfaConfig);
+}
+
+void optionPriceAndGreeks_r(Option* option, OptionGreeks* greeks, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("optionPriceAndGreeks_r");
+  if (option==NULL || greeks==NULL)
+  {
+    return;
+  }
+  double sqrtT=sqrt(option->T);
+  double sigSqrtT=option->sig*sqrtT;
+  double growth=exp(option->mu*option->T);
+  double F=option->S0*growth;
+  double z0=(log(option->K/option->S0)-option->T*(option->mu-((option->sig)*(option->sig)/2.0)))/sigSqrtT;
+  double d1=sigSqrtT-z0;
+  double sgn=(option->type==CALL) ? 1.0 : -1.0;
+  double PHI1=PHI_r(sgn*d1, cfg);
+  double PHI2=PHI_r(-sgn*z0, cfg);
+  double phi1=phi(d1);
+  greeks->price=sgn*(F*PHI1-option->K*PHI2);
+  greeks->delta=sgn*growth*PHI1;
+  greeks->gamma=growth*phi1/(option->S0*sigSqrtT);
+  greeks->vega=F*phi1*sqrtT;
+  greeks->theta=-(sgn*option->mu*F*PHI1+F*phi1*option->sig/(2*sqrtT));
+}
+
+void optionPriceAndGreeks(Option* option, OptionGreeks* greeks)
+{
+  optionPriceAndGreeks_r(option, greeks, &pfaConfig);
+}
+
+/* The options are priced by blocks of OPTION_BLOCK: each step of the formula is done for
+   the whole block (vecLog, vecExp and vecPHI use the vector instructions), with temporary
+   arrays small enough to stay in the L1 cache.
+   Call and put share the same formula with sgn = +1 (call) or -1 (put):
+     price = sgn * ( S0*exp(mu*T)*PHI(sgn*(sig*sqrt(T)-z0)) - K*PHI(-sgn*z0) )
+*/
+#define OPTION_BLOCK 256
+
+void optionPriceBatch(OptionBatch* batch, double* price)
+{
+  INSTRUMENT_SCOPE("optionPriceBatch");
+  if (batch == NULL)
+  {
+    return;
+  }
+  double logKS[OPTION_BLOCK], growth[OPTION_BLOCK], sigSqrtT[OPTION_BLOCK], sgn[OPTION_BLOCK];
+  double PHI1[OPTION_BLOCK], PHI2[OPTION_BLOCK];
+
+  for (int start = 0; start < batch->n; start += OPTION_BLOCK)
+  {
+    int len = (batch->n - start < OPTION_BLOCK) ? batch->n - start : OPTION_BLOCK;
+    double* S0 = batch->S0 + start;
+    double* K = batch->K + start;
+    double* T = batch->T + start;
+    double* mu = batch->mu + start;
+    double* sig = batch->sig + start;
+    OptionType* type = batch->type + start;
+
+    for (int i = 0; i < len; i++)
+    {
+      logKS[i] = K[i]/S0[i];
+      growth[i] = mu[i]*T[i];
+      sigSqrtT[i] = sig[i]*sqrt(T[i]);
+      sgn[i] = (type[i] == CALL) ? 1.0 : -1.0;
+    }
+    vecLog(logKS, logKS, len);
+    vecExp(growth, growth, len);
+    for (int i = 0; i < len; i++)
+    {
+      double z0 = (logKS[i]-T[i]*(mu[i]-(sig[i]*sig[i]/2.0)))/sigSqrtT[i];
+      PHI1[i] = sgn[i]*(sigSqrtT[i]-z0);
+      PHI2[i] = -sgn[i]*z0;
+    }
+    vecPHI(PHI1, PHI1, len);
+    vecPHI(PHI2, PHI2, len);
+    INSTRUMENT_CDF(2*len);
+    for (int i = 0; i < len; i++)
+    {
+      price[start+i] = sgn[i]*(S0[i]*growth[i]*PHI1[i]-K[i]*PHI2[i]);
+    }
+  }
+}
+
+
+/* Same blocks and formula as optionPriceBatch, in float. The estimate of the error adds,
+   with u the unit roundoff of float:
+   - the rounding of z0, dz = u*(1 + |log(K/S0)| + |mu*T| + sig*sig*T/2)/(sig*sqrt(T)) + 2u*|z0|,
+     times the slope of PHI at each argument (phi(d1) and phi(z0), computed with vecExpf),
+   - the error of vecPHIf (2e-7) and the rounding of the products and of the difference. */
+void optionPriceBatchf(OptionBatchf* batch, float* price, float* error)
+{
+  INSTRUMENT_SCOPE("optionPriceBatchf");
+  if (batch == NULL)
+  {
+    return;
+  }
+  float logKS[OPTION_BLOCK], growth[OPTION_BLOCK], sigSqrtT[OPTION_BLOCK], sgn[OPTION_BLOCK];
+  float PHI1[OPTION_BLOCK], PHI2[OPTION_BLOCK], dz[OPTION_BLOCK], slope1[OPTION_BLOCK], slope2[OPTION_BLOCK];
+  float u = FLT_EPSILON/2;
+
+  for (int start = 0; start < batch->n; start += OPTION_BLOCK)
+  {
+    int len = (batch->n - start < OPTION_BLOCK) ? batch->n - start : OPTION_BLOCK;
+    float* S0 = batch->S0 + start;
+    float* K = batch->K + start;
+    float* T = batch->T + start;
+    float* mu = batch->mu + start;
+    float* sig = batch->sig + start;
+    OptionType* type = batch->type + start;
+
+    for (int i = 0; i < len; i++)
+    {
+      logKS[i] = K[i]/S0[i];
+      growth[i] = mu[i]*T[i];
+      sigSqrtT[i] = sig[i]*sqrtf(T[i]);
+      sgn[i] = (type[i] == CALL) ? 1.0f : -1.0f;
+    }
+    vecLogf(logKS, logKS, len);
+    if (error != NULL)
+    {
+      for (int i = 0; i < len; i++)
+      {
+        dz[i] = u*(1.0f + fabsf(logKS[i]) + fabsf(growth[i]) + sig[i]*sig[i]*T[i]/2.0f)/sigSqrtT[i];
+      }
+    }
+    vecExpf(growth, growth, len);
+    for (int i = 0; i < len; i++)
+    {
+      float z0 = (logKS[i]-T[i]*(mu[i]-(sig[i]*sig[i]/2.0f)))/sigSqrtT[i];
+      PHI1[i] = sgn[i]*(sigSqrtT[i]-z0);
+      PHI2[i] = -sgn[i]*z0;
+    }
+    if (error != NULL)
+    {
+      for (int i = 0; i < len; i++)
+      {
+        dz[i] += 2.0f*u*fabsf(PHI2[i]);
+        slope1[i] = -PHI1[i]*PHI1[i]/2.0f;
+        slope2[i] = -PHI2[i]*PHI2[i]/2.0f;
+      }
+      vecExpf(slope1, slope1, len);
+      vecExpf(slope2, slope2, len);
+    }
+    vecPHIf(PHI1, PHI1, len);
+    vecPHIf(PHI2, PHI2, len);
+    INSTRUMENT_CDF(2*len);
+    for (int i = 0; i < len; i++)
+    {
+      price[start+i] = sgn[i]*(S0[i]*growth[i]*PHI1[i]-K[i]*PHI2[i]);
+    }
+    if (error != NULL)
+    {
+      for (int i = 0; i < len; i++)
+      {
+        float F = S0[i]*growth[i];
+        error[start+i] = F*(0.398942280f*slope1[i]*dz[i] + 2e-7f + 3.0f*u*PHI1[i])
+                       + K[i]*(0.398942280f*slope2[i]*dz[i] + 2e-7f + u*PHI2[i]) + u*fabsf(price[start+i]);
+      }
+    }
+  }
+}
+
+/* The sampled options are gathered by blocks of OPTION_BLOCK in double arrays, priced with
+   optionPriceBatch and compared with their float prices. The first sampled option is
+   sampleEvery/2, so that the check does not always read the first option of a period. */
+bool checkPriceBatchf(OptionBatchf* batch, float* price, PriceCheckf* check)
+{
+  INSTRUMENT_SCOPE("checkPriceBatchf");
+  check->checked = 0;
+  check->alerts = 0;
+  check->maxDrift = 0.0;
+  check->firstAlert = -1;
+  if (batch == NULL || check->sampleEvery < 1)
+  {
+    return true;
+  }
+  int index[OPTION_BLOCK];
+  OptionType type[OPTION_BLOCK];
+  double S0[OPTION_BLOCK], K[OPTION_BLOCK], T[OPTION_BLOCK], mu[OPTION_BLOCK], sig[OPTION_BLOCK];
+  double exact[OPTION_BLOCK];
+  OptionBatch sample = {0, type, S0, K, T, mu, sig};
+
+  int i = check->sampleEvery/2;
+  while (i < batch->n)
+  {
+    int len = 0;
+    for (; i < batch->n && len < OPTION_BLOCK; i += check->sampleEvery, len++)
+    {
+      index[len] = i;
+      type[len] = batch->type[i];
+      S0[len] = batch->S0[i];
+      K[len] = batch->K[i];
+      T[len] = batch->T[i];
+      mu[len] = batch->mu[i];
+      sig[len] = batch->sig[i];
+    }
+    sample.n = len;
+    optionPriceBatch(&sample, exact);
+    for (int j = 0; j < len; j++)
+    {
+      double drift = fabs(price[index[j]] - exact[j])/(S0[j]*exp(mu[j]*T[j]) + K[j]);
+      /* A NaN price is an alert too */
+      if (!(drift <= check->threshold))
+      {
+        if (check->alerts == 0)
+        {
+          check->firstAlert = index[j];
+        }
+        check->alerts++;
+      }
+      if (drift > check->maxDrift || isnan(drift))
+      {
+        check->maxDrift = drift;
+      }
+    }
+    check->checked += len;
   }
+  return check->alerts == 0;
 }
 
+/* Same blocks as optionPriceBatch, with phi(d1) (phi_batch) in addition to the two PHI */
+void optionPriceAndGreeksBatch(OptionBatch* batch, OptionGreeksBatch* greeks)
+{
+  INSTRUMENT_SCOPE("optionPriceAndGreeksBatch");
+  if (batch == NULL || greeks == NULL)
+  {
+    return;
+  }
+  double logKS[OPTION_BLOCK], growth[OPTION_BLOCK], sigSqrtT[OPTION_BLOCK], sgn[OPTION_BLOCK];
+  double PHI1[OPTION_BLOCK], PHI2[OPTION_BLOCK], phi1[OPTION_BLOCK];
+
+  for (int start = 0; start < batch->n; start += OPTION_BLOCK)
+  {
+    int len = (batch->n - start < OPTION_BLOCK) ? batch->n - start : OPTION_BLOCK;
+    double* S0 = batch->S0 + start;
+    double* K = batch->K + start;
+    double* T = batch->T + start;
+    double* mu = batch->mu + start;
+    double* sig = batch->sig + start;
+    OptionType* type = batch->type + start;
+
+    for (int i = 0; i < len; i++)
+    {
+      logKS[i] = K[i]/S0[i];
+      growth[i] = mu[i]*T[i];
+      sigSqrtT[i] = sig[i]*sqrt(T[i]);
+      sgn[i] = (type[i] == CALL) ? 1.0 : -1.0;
+    }
+    vecLog(logKS, logKS, len);
+    vecExp(growth, growth, len);
+    for (int i = 0; i < len; i++)
+    {
+      double z0 = (logKS[i]-T[i]*(mu[i]-(sig[i]*sig[i]/2.0)))/sigSqrtT[i];
+      phi1[i] = sigSqrtT[i]-z0;
+      PHI1[i] = sgn[i]*phi1[i];
+      PHI2[i] = -sgn[i]*z0;
+    }
+    vecPHI(PHI1, PHI1, len);
+    vecPHI(PHI2, PHI2, len);
+    INSTRUMENT_CDF(2*len);
+    phi_batch(phi1, phi1, len);
+    for (int i = 0; i < len; i++)
+    {
+      double F = S0[i]*growth[i];
+      double sqrtT = sqrt(T[i]);
+      greeks->price[start+i] = sgn[i]*(F*PHI1[i]-K[i]*PHI2[i]);
+      greeks->delta[start+i] = sgn[i]*growth[i]*PHI1[i];
+      greeks->gamma[start+i] = growth[i]*phi1[i]/(S0[i]*sigSqrtT[i]);
+      greeks->vega[start+i] = F*phi1[i]*sqrtT;
+      greeks->theta[start+i] = -(sgn[i]*mu[i]*F*PHI1[i]+F*phi1[i]*sig[i]/(2*sqrtT));
+    }
+  }
+}
+
+/* Maximal number of Halley steps of impliedVolBatch */
+#define IV_MAX_ITER 40
+
+/* The inversion is done on the call with forward F = S0*exp(mu*T) (a put is turned into a
+   call by the parity call - put = F - K), and with the total volatility v = sig*sqrt(T):
+     c(v) = F*PHI(d1) - K*PHI(d2),  d1 = log(F/K)/v + v/2,  d2 = d1 - v
+     c'(v) = F*phi(d1),  c''(v) = c'(v)*d1*d2/v */
+int impliedVolBatch(OptionBatch* batch, double* prices, ImpliedVolStatus* status)
+{
+  INSTRUMENT_SCOPE("impliedVolBatch");
+  if (batch == NULL || prices == NULL || status == NULL)
+  {
+    return 0;
+  }
+  int failures = 0;
+  /* Per running option: index, F, K, log(F/K), target call price, v, bracket [lo, hi] */
+  int index[OPTION_BLOCK];
+  double F[OPTION_BLOCK], K[OPTION_BLOCK], X[OPTION_BLOCK], target[OPTION_BLOCK], v[OPTION_BLOCK], lo[OPTION_BLOCK], hi[OPTION_BLOCK];
+  double d1[OPTION_BLOCK], d2[OPTION_BLOCK], dens[OPTION_BLOCK];
+
+  for (int start = 0; start < batch->n; start += OPTION_BLOCK)
+  {
+    int len = (batch->n - start < OPTION_BLOCK) ? batch->n - start : OPTION_BLOCK;
+    int active = 0;
+    for (int j = 0; j < len; j++)
+    {
+      int i = start + j;
+      double S0 = batch->S0[i], T = batch->T[i], strike = batch->K[i], price = prices[i];
+      batch->sig[i] = NAN;
+      if (!(S0 > 0 && strike > 0 && T > 0) || isnan(price) || isnan(batch->mu[i]))
+      {
+        status[i] = IV_INVALID;
+        failures++;
+        continue;
+      }
+      double forward = S0*exp(batch->mu[i]*T);
+      double call = (batch->type[i] == CALL) ? price : price + forward - strike;
+      double intrinsic = (forward > strike) ? forward - strike : 0.0;
+      if (call <= intrinsic)
+      {
+        status[i] = IV_BELOW_INTRINSIC;
+        failures++;
+        continue;
+      }
+      if (call >= forward)
+      {
+        status[i] = IV_ABOVE_MAX;
+        failures++;
+        continue;
+      }
+      /* Corrado-Miller: v ~ sqrt(2 pi)/(F+K) * (c - (F-K)/2 + sqrt((c - (F-K)/2)^2 - (F-K)^2/pi)) */
+      double half = call - (forward - strike)/2;
+      double delta = half*half - (forward - strike)*(forward - strike)/M_PI;
+      double guess = sqrt(2*M_PI)/(forward + strike)*(half + sqrt((delta > 0) ? delta : 0.0));
+      index[active] = i;
+      F[active] = forward;
+      K[active] = strike;
+      X[active] = log(forward/strike);
+      target[active] = call;
+      v[active] = (guess > 1e-8) ? guess : 1e-8;
+      lo[active] = 0.0;
+      hi[active] = INFINITY;
+      status[i] = IV_NO_CONVERGENCE;
+      active++;
+    }
+
+    for (int iter = 0; iter < IV_MAX_ITER && active > 0; iter++)
+    {
+      for (int j = 0; j < active; j++)
+      {
+        d1[j] = X[j]/v[j] + v[j]/2;
+        d2[j] = d1[j] - v[j];
+        dens[j] = d1[j];
+      }
+      vecPHI(d1, d1, active);
+      vecPHI(d2, d2, active);
+      INSTRUMENT_CDF(2*active);
+      phi_batch(dens, dens, active);
+      int running = 0;
+      for (int j = 0; j < active; j++)
+      {
+        double f = F[j]*d1[j] - K[j]*d2[j] - target[j];
+        int i = index[j];
+        if (fabs(f) <= 1e-14*(F[j] + K[j]))
+        {
+          batch->sig[i] = v[j]/sqrt(batch->T[i]);
+          status[i] = IV_OK;
+          continue;
+        }
+        /* c is increasing in v: the bracket keeps the root */
+        if (f > 0) hi[j] = v[j]; else lo[j] = v[j];
+        double e1 = X[j]/v[j] + v[j]/2;
+        double vega = F[j]*dens[j];
+        double volga = vega*e1*(e1 - v[j])/v[j];
+        double step = (vega > 0) ? f/vega : INFINITY;
+        double halley = 1.0 - step*volga/(2*vega);
+        if (vega > 0 && halley > 0.5)
+        {
+          step /= halley;
+        }
+        double next = v[j] - step;
+        if (!(next > lo[j] && next < hi[j]))
+        {
+          next = isfinite(hi[j]) ? (lo[j] + hi[j])/2 : 2*v[j];
+        }
+        double change = fabs(next - v[j]);
+        v[j] = next;
+        if (change <= 1e-12*(1.0 + v[j]))
+        {
+          batch->sig[i] = v[j]/sqrt(batch->T[i]);
+          status[i] = IV_OK;
+          continue;
+        }
+        /* Still running: moved down to keep the running options contiguous */
+        index[running] = i;
+        F[running] = F[j];
+        K[running] = K[j];
+        X[running] = X[j];
+        target[running] = target[j];
+        v[running] = v[j];
+        lo[running] = lo[j];
+        hi[running] = hi[j];
+        running++;
+      }
+      active = running;
+    }
+    for (int j = 0; j < active; j++)
+    {
+      batch->sig[index[j]] = v[j]/sqrt(batch->T[index[j]]);
+      failures++;
+    }
+  }
+  return failures;
+}
 
 
 /* ===============================================*/
@@ -89,58 +677,546 @@ double clientPDF_X(InsuredClient* client, double x)
   return (1.0/(client->s*x))*phi((log(x)-client->m)/client->s);;
 }
 
+/* Same computation as clientPDF_X, by blocks of PDF_BLOCK values, with vecLog and vecExp */
+#define PDF_BLOCK 256
+
+void clientPDF_X_batch(InsuredClient* client, double* x, double* y, size_t n)
+{
+  INSTRUMENT_PHI(n);
+  double z[PDF_BLOCK];
+  for (size_t start = 0; start < n; start += PDF_BLOCK)
+  {
+    size_t len = (n - start < PDF_BLOCK) ? n - start : PDF_BLOCK;
+    double* xs = x + start;
+    double* ys = y + start;
+    if (client == NULL)
+    {
+      memset(ys, 0, len*sizeof(double));
+      continue;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+      z[i] = (xs[i] > 0) ? xs[i] : 1.0;
+    }
+    vecLog(z, z, len);
+    for (size_t i = 0; i < len; i++)
+    {
+      double u = (z[i]-client->m)/client->s;
+      z[i] = -u*u/2;
+    }
+    vecExp(z, z, len);
+    for (size_t i = 0; i < len; i++)
+    {
+      ys[i] = (xs[i] > 0) ? (1.0/(client->s*xs[i]))*(0.398942280401433*z[i]) : 0.0;
+    }
+  }
+}
+
 
 /* Cumulative distribution function (CDF) of variable X.
    X is the reimbursement in case of a claim from the client.
 */
-double clientCDF_X(InsuredClient* client, double x)
+double clientCDF_X_r(InsuredClient* client, double x, PfaConfig* cfg)
 {
   if (x <=0 || client==NULL)
   {
     return 0.0;
   }
-  return PHI((log(x)-client->m)/client->s);
+  return PHI_r((log(x)-client->m)/client->s, cfg);
+}
+
+double clientCDF_X(InsuredClient* client, double x)
+{
+  return clientCDF_X_r(client, x, &pfaConfig);
+}
+
+/* x -> (log(x)-m)/s is increasing: the curve of X is a curve of PHI */
+bool clientCDF_X_curve_r(InsuredClient* client, double* xs, int k, double* out, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("clientCDF_X_curve_r");
+  if (client == NULL || !validThresholds(xs, k))
+  {
+    return false;
+  }
+  int first = 0; /* First positive threshold */
+  while (first < k && xs[first] <= 0)
+  {
+    out[first] = 0.0;
+    first++;
+  }
+  double* zs = malloc((k - first + 1) * sizeof(double));
+  for (int j = first; j < k; j++)
+  {
+    zs[j - first] = (log(xs[j])-client->m)/client->s;
+  }
+  PHI_curve_r(zs, k - first, out + first, cfg);
+  free(zs);
+  return true;
+}
+
+bool clientCDF_X_curve(InsuredClient* client, double* xs, int k, double* out)
+{
+  return clientCDF_X_curve_r(client, xs, k, out, &pfaConfig);
 }
 
 /* ==========================================================*/
 /* Distribution of X1+X2 : static intermediate functions     */
 
-/* The static functions localProductPDF and localPDF_X1X2 take only one
-   argument, of type double.
-   They hence can be integrated: function integrate_dx takes as argument a function pointer f, 
-   where f depends only on one argument (double t).
-   The static functions below can be given as argument to integrate_dx.
+/* The static function localPDF_X1X2 takes one argument of type double, and a pointer
+   to a LocalData structure.
+   It hence can be integrated: function integrate_dx_r takes as argument a function
+   pointer f, where f depends on one argument (double t) and on the data given to
+   integrate_dx_r. In the same way, localProductPDF is evaluated on arrays of t, and can
+   be given to integrate_dx_batch.
 
-   That's why we copy other variables of the final functions (client and x) to local static variables, 
-   and define these static functions depending on only one argument (double t).
-   These local functions can hence be arguments of integrate_dx.
+   That's why we copy other variables of the final functions (client, x and the
+   configuration) to a LocalData structure, instead of static variables: each call
+   has its own copy, so the final functions are reentrant.
 */
-static InsuredClient* localClient;
-static double localX;
+typedef struct{
+  InsuredClient* client;
+  double x;
+  PfaConfig* cfg;
+} LocalData;
 
 
-/* This function assumes that static variables localClient and localX have been set.
-   It can be an argument of integrate_dx (since it has the good signature)
+/* y[i] = fX(x - t[i]) * fX(t[i]), where data points to a LocalData structure where
+   client and x have been set.
+   It can be an argument of integrate_dx_batch (since it has the good signature)
 */
-static double localProductPDF(double t)
+static void localProductPDF(double* t, double* y, size_t n, void* data)
 {
-  return clientPDF_X(localClient, localX - t) * clientPDF_X(localClient, t);
+  LocalData* local = (LocalData*) data;
+  double u[INTEGRATION_BATCH_NODES];
+  for (size_t i = 0; i < n; i++)
+  {
+    u[i] = local->x - t[i];
+  }
+  clientPDF_X_batch(local->client, u, u, n);
+  clientPDF_X_batch(local->client, t, y, n);
+  for (size_t i = 0; i < n; i++)
+  {
+    y[i] *= u[i];
+  }
 }
 
 /* Density of X1+X2
 
-   This function assumes that static variable localClient has been set.
-   It is called by clientPDF_X1X2
-   It can also be an argument of integrate_dx (since it has the good signature)
+   data points to a LocalData structure where client and cfg have been set.
+   It is called by clientPDF_X1X2_r
+   It can also be an argument of integrate_dx_r (since it has the good signature)
 */
-static double localPDF_X1X2(double x)
+static double localPDF_X1X2(double x, void* data)
 {
   if (x <= 0.0)
   {
     return 0.0;
   }
-  localX=x;   
-  return integrate_dx(localProductPDF, 0, x, pfa_dt, &pfaQF);
+  LocalData local = *(LocalData*) data;
+  local.x=x;
+  return integrate_dx_batch(localProductPDF, &local, 0, x, &local.cfg->integ);
+}
+
+
+/* ==========================================================*/
+/* Cache of the values of clientCDF_X1X2                     */
+
+typedef struct{
+  double m;
+  double s;
+  double x;
+  double h1; /* dx, or epsabs in adaptive mode */
+  double h2; /* 0, or epsrel in adaptive mode */
+  int rule;  /* Handle of the quadrature formula, -1 in adaptive mode */
+  int grid;  /* 1 with the severity grid */
+} CacheKey;
+
+/* The entries are in a fixed array of capacity elements. They are chained in the buckets
+   of a hash table (next), and in a list from the most to the least recently used (older, newer). */
+typedef struct{
+  CacheKey key;
+  double value;
+  int next;
+  int older;
+  int newer;
+} CacheEntry;
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static CacheEntry* cacheEntries = NULL;
+static int* cacheBuckets = NULL;
+static int cacheNbBuckets = 0; /* A power of 2 */
+static int cacheFirst = -1;    /* Most recently used */
+static int cacheLast = -1;     /* Least recently used */
+static CacheStats cacheCounters = {0, 0, 0, 0, 0};
+
+static CacheKey cacheKey(InsuredClient* client, double x, PfaConfig* cfg)
+{
+  CacheKey key = {0.0, 0.0, 0.0, 0.0, 0.0, 0, 0};
+  key.m = client->m;
+  key.s = client->s;
+  key.x = x;
+  if (cfg->integ.adaptive)
+  {
+    key.h1 = cfg->integ.epsabs;
+    key.h2 = cfg->integ.epsrel;
+    key.rule = -1;
+  }
+  else
+  {
+    key.h1 = cfg->integ.dx;
+    key.rule = cfg->integ.qf.rule;
+    key.grid = cfg->severityGrid ? 1 : 0;
+  }
+  return key;
+}
+
+/* The keys are hashed and compared field by field (never the padding bytes of the
+   structure), the doubles by their bits: 0.0 and -0.0 are different keys, as are two NaN
+   of different payloads, which only costs a computation. */
+static uint64_t hashBytes(uint64_t h, void* data, size_t n)
+{
+  unsigned char* bytes = (unsigned char*) data;
+  for (size_t i = 0; i < n; i++)
+  {
+    h = (h ^ bytes[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+/* FNV-1a on the fields of the key */
+static int cacheHash(CacheKey* key)
+{
+  uint64_t h = 14695981039346656037ULL;
+  h = hashBytes(h, &key->m, sizeof(key->m));
+  h = hashBytes(h, &key->s, sizeof(key->s));
+  h = hashBytes(h, &key->x, sizeof(key->x));
+  h = hashBytes(h, &key->h1, sizeof(key->h1));
+  h = hashBytes(h, &key->h2, sizeof(key->h2));
+  h = hashBytes(h, &key->rule, sizeof(key->rule));
+  h = hashBytes(h, &key->grid, sizeof(key->grid));
+  return (int) ((h ^ (h >> 32)) & (uint64_t) (cacheNbBuckets - 1));
+}
+
+static bool sameBits(double a, double b)
+{
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+static bool sameKey(CacheKey* a, CacheKey* b)
+{
+  return sameBits(a->m, b->m) && sameBits(a->s, b->s) && sameBits(a->x, b->x)
+         && sameBits(a->h1, b->h1) && sameBits(a->h2, b->h2)
+         && a->rule == b->rule && a->grid == b->grid;
+}
+
+/* Removes entry i from the list of uses */
+static void cacheUnlink(int i)
+{
+  CacheEntry* e = &cacheEntries[i];
+  if (e->newer >= 0) cacheEntries[e->newer].older = e->older; else cacheFirst = e->older;
+  if (e->older >= 0) cacheEntries[e->older].newer = e->newer; else cacheLast = e->newer;
+}
+
+/* Puts entry i at the beginning of the list of uses */
+static void cachePushFirst(int i)
+{
+  cacheEntries[i].newer = -1;
+  cacheEntries[i].older = cacheFirst;
+  if (cacheFirst >= 0) cacheEntries[cacheFirst].newer = i; else cacheLast = i;
+  cacheFirst = i;
+}
+
+/* Index of the entry of key in the cache, or -1. cacheLock must be held. */
+static int cacheFind(CacheKey* key, int bucket)
+{
+  for (int i = cacheBuckets[bucket]; i >= 0; i = cacheEntries[i].next)
+  {
+    if (sameKey(&cacheEntries[i].key, key))
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool init_cache(int capacity)
+{
+  if (capacity < 0)
+  {
+    return false;
+  }
+  int nbBuckets = 1;
+  while (nbBuckets < 2*capacity)
+  {
+    nbBuckets *= 2;
+  }
+  CacheEntry* entries = NULL;
+  int* buckets = NULL;
+  if (capacity > 0)
+  {
+    entries = malloc(capacity * sizeof(CacheEntry));
+    buckets = malloc(nbBuckets * sizeof(int));
+    if (entries == NULL || buckets == NULL)
+    {
+      free(entries);
+      free(buckets);
+      return false;
+    }
+    for (int b = 0; b < nbBuckets; b++)
+    {
+      buckets[b] = -1;
+    }
+  }
+  pthread_mutex_lock(&cacheLock);
+  free(cacheEntries);
+  free(cacheBuckets);
+  cacheEntries = entries;
+  cacheBuckets = buckets;
+  cacheNbBuckets = nbBuckets;
+  cacheFirst = -1;
+  cacheLast = -1;
+  CacheStats zero = {0, 0, 0, 0, capacity};
+  cacheCounters = zero;
+  pthread_mutex_unlock(&cacheLock);
+  return true;
+}
+
+void clear_cache(void)
+{
+  pthread_mutex_lock(&cacheLock);
+  for (int b = 0; b < cacheNbBuckets && cacheBuckets != NULL; b++)
+  {
+    cacheBuckets[b] = -1;
+  }
+  cacheFirst = -1;
+  cacheLast = -1;
+  CacheStats zero = {0, 0, 0, 0, cacheCounters.capacity};
+  cacheCounters = zero;
+  pthread_mutex_unlock(&cacheLock);
+}
+
+void cache_stats(CacheStats* stats)
+{
+  pthread_mutex_lock(&cacheLock);
+  *stats = cacheCounters;
+  pthread_mutex_unlock(&cacheLock);
+}
+
+/* Looks for key in the cache. Returns true and sets *value if it is there. */
+static bool cacheGet(CacheKey* key, double* value)
+{
+  bool found = false;
+  pthread_mutex_lock(&cacheLock);
+  if (cacheCounters.capacity > 0)
+  {
+    int i = cacheFind(key, cacheHash(key));
+    if (i >= 0)
+    {
+      *value = cacheEntries[i].value;
+      cacheUnlink(i);
+      cachePushFirst(i);
+      cacheCounters.hits++;
+      found = true;
+    }
+    else
+    {
+      cacheCounters.misses++;
+    }
+  }
+  pthread_mutex_unlock(&cacheLock);
+  return found;
+}
+
+/* Stores the value of key, in place of the least recently used value if the cache is full.
+   The value is computed outside of the lock: another thread may have stored it meanwhile. */
+static void cachePut(CacheKey* key, double value)
+{
+  pthread_mutex_lock(&cacheLock);
+  if (cacheCounters.capacity > 0)
+  {
+    int bucket = cacheHash(key);
+    if (cacheFind(key, bucket) < 0)
+    {
+      int i;
+      if (cacheCounters.size < cacheCounters.capacity)
+      {
+        i = cacheCounters.size++;
+      }
+      else
+      {
+        i = cacheLast;
+        cacheUnlink(i);
+        int* link = &cacheBuckets[cacheHash(&cacheEntries[i].key)];
+        while (*link != i)
+        {
+          link = &cacheEntries[*link].next;
+        }
+        *link = cacheEntries[i].next;
+        cacheCounters.evictions++;
+      }
+      cacheEntries[i].key = *key;
+      cacheEntries[i].value = value;
+      cacheEntries[i].next = cacheBuckets[bucket];
+      cacheBuckets[bucket] = i;
+      cachePushFirst(i);
+    }
+  }
+  pthread_mutex_unlock(&cacheLock);
+}
+
+
+/* ==========================================================*/
+/* Distribution of X1+X2 : shared severity grid              */
+
+bool init_severity_grid_r(PfaConfig* cfg, bool enabled)
+{
+  if (cfg == NULL)
+  {
+    return false;
+  }
+  cfg->severityGrid = enabled;
+  return true;
+}
+
+bool init_severity_grid(bool enabled)
+{
+  return init_severity_grid_r(&pfaConfig, enabled);
+}
+
+/* Index of offset in offsets[0..*nb-1], added if it is not there */
+static int gridOffset(double* offsets, int* nb, double offset)
+{
+  for (int d = 0; d < *nb; d++)
+  {
+    if (offsets[d] == offset)
+    {
+      return d;
+    }
+  }
+  offsets[*nb] = offset;
+  return (*nb)++;
+}
+
+/* Points of the last subdivisions evaluated at once by gridCDF_X1X2 */
+#define GRID_LAST_POINTS 8192
+
+/* clientCDF_X1X2 with the severity grid (see init_severity_grid).
+   With the nodes c[0..n-1] and weights w of the formula, the outer nodes are
+   y = (i + c[q])*h, and the inner integral at y is
+     h * sum_{j<i} sum_r w[r] fX((i-j + c[q]-c[r])*h) fX((j + c[r])*h)     (grid)
+   + c[q]*h * sum_r w[r] fX(y - u) fX(u), u = (i + c[q]*c[r])*h            (last subdivision)
+   The points of the last subdivisions are evaluated by chunks of subdivisions.
+   Returns false, without computing, if the memory can not be allocated. */
+static bool gridCDF_X1X2(InsuredClient* client, double x, PfaConfig* cfg, double* value)
+{
+  INSTRUMENT_SCOPE("gridCDF_X1X2");
+  QuadFormula* qf = &cfg->integ.qf;
+  int n = qf->n;
+  int N = (int) round(x/cfg->integ.dx);
+  N = (N < 1) ? 1 : N;
+  double h = x/N;
+
+  /* table[d*(N+1) + k] = fX((k + offsets[d])*h), k = 0..N */
+  double* offsets = malloc((n + n*n)*sizeof(double));
+  int* node = malloc((n + n*n)*sizeof(int));
+  if (offsets == NULL || node == NULL)
+  {
+    free(offsets);
+    free(node);
+    return false;
+  }
+  int* diff = node + n;
+  int nbOffsets = 0;
+  for (int r = 0; r < n; r++)
+  {
+    node[r] = gridOffset(offsets, &nbOffsets, qf->x[r]);
+  }
+  for (int q = 0; q < n; q++)
+  {
+    for (int r = 0; r < n; r++)
+    {
+      diff[q*n+r] = gridOffset(offsets, &nbOffsets, qf->x[q] - qf->x[r]);
+    }
+  }
+  /* Last subdivisions of a chunk: u[(l*n + q)*n + r] and v = y - u, y = (i + c[q])*h,
+     for the subdivisions i = first + l of the chunk */
+  int chunk = GRID_LAST_POINTS/(n*n);
+  chunk = (chunk < 1) ? 1 : chunk;
+  size_t nbLast = (size_t) chunk*n*n;
+  size_t size = (size_t) nbOffsets*(N+1);
+  double* table = malloc(size*sizeof(double));
+  double* u = malloc(2*nbLast*sizeof(double));
+  if (table == NULL || u == NULL)
+  {
+    free(u);
+    free(table);
+    free(node);
+    free(offsets);
+    return false;
+  }
+  INSTRUMENT_INTEGRAL(N, (long) size + 2L*N*n*n);
+  for (int d = 0; d < nbOffsets; d++)
+  {
+    for (int k = 0; k <= N; k++)
+    {
+      table[(size_t) d*(N+1) + k] = (k + offsets[d])*h;
+    }
+  }
+  clientPDF_X_batch(client, table, table, size);
+
+  double total = 0.0;
+  for (int first = 0; first < N; first += chunk)
+  {
+    int last = (first + chunk < N) ? first + chunk : N;
+    size_t points = (size_t) (last - first)*n*n;
+    double* v = u + points;
+    for (int i = first; i < last; i++)
+    {
+      for (int q = 0; q < n; q++)
+      {
+        for (int r = 0; r < n; r++)
+        {
+          size_t l = ((size_t) (i - first)*n + q)*n + r;
+          u[l] = (i + qf->x[q]*qf->x[r])*h;
+          v[l] = (i + qf->x[q])*h - u[l];
+        }
+      }
+    }
+    clientPDF_X_batch(client, u, u, 2*points);
+    for (int i = first; i < last; i++)
+    {
+      for (int q = 0; q < n; q++)
+      {
+        double inner = 0.0;
+        for (int r = 0; r < n; r++)
+        {
+          double* fy = table + (size_t) diff[q*n+r]*(N+1) + i; /* fy[-j] = fX((i-j + c[q]-c[r])*h) */
+          double* ft = table + (size_t) node[r]*(N+1);         /* ft[j] = fX((j + c[r])*h) */
+          double partial = 0.0;
+          for (int j = 0; j < i; j++)
+          {
+            partial += fy[-j]*ft[j];
+          }
+          inner += qf->w[r]*partial;
+        }
+        inner *= h;
+        double lastSub = 0.0;
+        for (int r = 0; r < n; r++)
+        {
+          size_t l = ((size_t) (i - first)*n + q)*n + r;
+          lastSub += qf->w[r]*u[l]*v[l];
+        }
+        inner += qf->x[q]*h*lastSub;
+        total += qf->w[q]*inner;
+      }
+    }
+  }
+  free(u);
+  free(table);
+  free(node);
+  free(offsets);
+  *value = h*total;
+  return true;
 }
 
 
@@ -151,12 +1227,18 @@ static double localPDF_X1X2(double x)
    X1 and X2 are the reimbursements of the two claims from the client (assuming there are 
    two claims).
 */
-double clientPDF_X1X2(InsuredClient* client, double x)
+double clientPDF_X1X2_r(InsuredClient* client, double x, PfaConfig* cfg)
 {
+  INSTRUMENT_SCOPE("clientPDF_X1X2_r");
   if ( x<=0 ) return 0.0;
 
-  localClient = client;
-  return localPDF_X1X2(x);
+  LocalData local = {client, x, cfg};
+  return localPDF_X1X2(x, &local);
+}
+
+double clientPDF_X1X2(InsuredClient* client, double x)
+{
+  return clientPDF_X1X2_r(client, x, &pfaConfig);
 }
 
 
@@ -164,12 +1246,53 @@ double clientPDF_X1X2(InsuredClient* client, double x)
    X1 and X2 are the reimbursements of the two claims from the client (assuming there are 
    two claims).
 */
+double clientCDF_X1X2_r(InsuredClient* client, double x, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("clientCDF_X1X2_r");
+  if ( x<=0 ) return 0.0;
+
+  CacheKey key = cacheKey(client, x, cfg);
+  double value;
+  if (cacheGet(&key, &value))
+  {
+    return value;
+  }
+  /* Without the memory of the grid, the integrals of clientPDF_X1X2 */
+  if (!cfg->severityGrid || cfg->integ.adaptive || !gridCDF_X1X2(client, x, cfg, &value))
+  {
+    LocalData local = {client, x, cfg};
+    value = integrate_dx_r(localPDF_X1X2, &local, 0, x, &cfg->integ);
+  }
+  cachePut(&key, value);
+  return value;
+}
+
 double clientCDF_X1X2(InsuredClient* client, double x)
 {
-    if ( x<=0 ) return 0.0;
-    
-  localClient = client;
-  return integrate_dx(localPDF_X1X2, 0, x, pfa_dt, &pfaQF);
+  return clientCDF_X1X2_r(client, x, &pfaConfig);
+}
+
+/* One running integral of the density of X1+X2 from 0 */
+bool clientCDF_X1X2_curve_r(InsuredClient* client, double* xs, int k, double* out, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("clientCDF_X1X2_curve_r");
+  if (client == NULL || !validThresholds(xs, k))
+  {
+    return false;
+  }
+  int first = 0; /* First positive threshold */
+  while (first < k && xs[first] <= 0)
+  {
+    out[first] = 0.0;
+    first++;
+  }
+  LocalData local = {client, 0.0, cfg};
+  return integrate_cumulative_r(localPDF_X1X2, &local, 0, xs + first, k - first, &cfg->integ, out + first);
+}
+
+bool clientCDF_X1X2_curve(InsuredClient* client, double* xs, int k, double* out)
+{
+  return clientCDF_X1X2_curve_r(client, xs, k, out, &pfaConfig);
 }
 
 
@@ -177,9 +1300,10 @@ double clientCDF_X1X2(InsuredClient* client, double x)
 /* Cumulative distribution function (CDF) of variable S.
    Variable S is the sum of the reimbursements that the insurance company will pay to client.
 */
-double clientCDF_S(InsuredClient* client, double x)
+double clientCDF_S_r(InsuredClient* client, double x, PfaConfig* cfg)
 {
-  if ( x<=0 )
+  INSTRUMENT_SCOPE("clientCDF_S_r");
+  if ( x<0 )
   {
     return 0.0;
   }
@@ -187,8 +1311,302 @@ double clientCDF_S(InsuredClient* client, double x)
   {
     return client->p[0]; 
   }
-  return client->p[0]+client->p[1]*clientCDF_X(client, x)+client->p[2]*clientCDF_X1X2(client,x);
+  return client->p[0]+client->p[1]*clientCDF_X_r(client, x, cfg)+client->p[2]*clientCDF_X1X2_r(client, x, cfg);
+}
+
+double clientCDF_S(InsuredClient* client, double x)
+{
+  return clientCDF_S_r(client, x, &pfaConfig);
+}
+
+bool clientCDF_S_curve_r(InsuredClient* client, double* xs, int k, double* out, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("clientCDF_S_curve_r");
+  if (client == NULL || !validThresholds(xs, k))
+  {
+    return false;
+  }
+  double* cdfX1X2 = malloc((k+1) * sizeof(double));
+  clientCDF_X_curve_r(client, xs, k, out, cfg);
+  clientCDF_X1X2_curve_r(client, xs, k, cdfX1X2, cfg);
+  for (int j = 0; j < k; j++)
+  {
+    if (xs[j] < 0)
+    {
+      out[j] = 0.0;
+    }
+    else if (xs[j] == 0)
+    {
+      out[j] = client->p[0];
+    }
+    else
+    {
+      out[j] = client->p[0]+client->p[1]*out[j]+client->p[2]*cdfX1X2[j];
+    }
+  }
+  free(cdfX1X2);
+  return true;
+}
+
+bool clientCDF_S_curve(InsuredClient* client, double* xs, int k, double* out)
+{
+  return clientCDF_S_curve_r(client, xs, k, out, &pfaConfig);
 }
 
 
+/* ==========================================================*/
+/* Quantiles of S                                            */
+
+/* Maximal number of iterations of the solver for one quantile */
+#define QUANTILE_MAX_ITER 200
+/* Bound of the bracket: at most QUANTILE_MAX_STEPS subdivisions of dx (the cost of the
+   probes grows as (x/dx)^2), or QUANTILE_MAX_BRACKET doublings in adaptive mode */
+#define QUANTILE_MAX_STEPS 10000
+#define QUANTILE_MAX_BRACKET 64
+
+/* The values of FX1X2 already computed for one client, at the abscissae x[0] < ... < x[n-1]
+   (x[0] = 0). A new value is the nearest known value plus the integral of the density
+   between the two abscissae: the successive probes of the solver only integrate on short
+   intervals, instead of integrating from 0 each time. */
+typedef struct{
+  InsuredClient* client;
+  PfaConfig* cfg;
+  int n;
+  int size;
+  double* x;
+  double* F;
+} QuantileSolver;
+
+static bool initQuantileSolver(QuantileSolver* solver, InsuredClient* client, PfaConfig* cfg)
+{
+  solver->client = client;
+  solver->cfg = cfg;
+  solver->n = 1;
+  solver->size = 64;
+  solver->x = malloc(solver->size * sizeof(double));
+  solver->F = malloc(solver->size * sizeof(double));
+  if (solver->x == NULL || solver->F == NULL)
+  {
+    free(solver->x);
+    free(solver->F);
+    return false;
+  }
+  solver->x[0] = 0.0;
+  solver->F[0] = 0.0;
+  return true;
+}
+
+static void freeQuantileSolver(QuantileSolver* solver)
+{
+  free(solver->x);
+  free(solver->F);
+}
 
+/* FX1X2(x), x > 0, from the nearest known value. It is added to the known values. */
+static double solverCDF_X1X2(QuantileSolver* solver, double x)
+{
+  /* i: last known abscissa <= x */
+  int lo = 0, hi = solver->n;
+  while (hi - lo > 1)
+  {
+    int mid = (lo + hi)/2;
+    if (solver->x[mid] <= x) lo = mid; else hi = mid;
+  }
+  int i = lo;
+  if (solver->x[i] == x)
+  {
+    return solver->F[i];
+  }
+  LocalData local = {solver->client, 0.0, solver->cfg};
+  double F;
+  if (i+1 < solver->n && solver->x[i+1] - x < x - solver->x[i])
+  {
+    F = solver->F[i+1] - integrate_dx_r(localPDF_X1X2, &local, x, solver->x[i+1], &solver->cfg->integ);
+  }
+  else
+  {
+    F = solver->F[i] + integrate_dx_r(localPDF_X1X2, &local, solver->x[i], x, &solver->cfg->integ);
+  }
+  if (solver->n == solver->size)
+  {
+    int size = 2*solver->size;
+    double* xs = realloc(solver->x, size * sizeof(double));
+    if (xs != NULL) solver->x = xs;
+    double* Fs = realloc(solver->F, size * sizeof(double));
+    if (Fs != NULL) solver->F = Fs;
+    if (xs == NULL || Fs == NULL)
+    {
+      return F; /* Not kept */
+    }
+    solver->size = size;
+  }
+  memmove(solver->x + i+2, solver->x + i+1, (solver->n - i-1) * sizeof(double));
+  memmove(solver->F + i+2, solver->F + i+1, (solver->n - i-1) * sizeof(double));
+  solver->x[i+1] = x;
+  solver->F[i+1] = F;
+  solver->n++;
+  return F;
+}
+
+/* FS(x) for x > 0 */
+static double solverCDF_S(QuantileSolver* solver, double x)
+{
+  double* p = solver->client->p;
+  double F = p[0] + p[1]*clientCDF_X_r(solver->client, x, solver->cfg);
+  if (p[2] != 0.0)
+  {
+    F += p[2]*solverCDF_X1X2(solver, x);
+  }
+  return F;
+}
+
+/* Density of S for x > 0 (derivative of FS, without the mass p[0] at 0) */
+static double solverPDF_S(QuantileSolver* solver, double x)
+{
+  double* p = solver->client->p;
+  double f = p[1]*clientPDF_X(solver->client, x);
+  if (p[2] != 0.0)
+  {
+    f += p[2]*clientPDF_X1X2_r(solver->client, x, solver->cfg);
+  }
+  return f;
+}
+
+/* Smallest x such that FS(x) >= alpha, for p[0] < alpha < 1.
+   [lo, hi] is a bracket: FS(lo) < alpha <= FS(hi). It is found from the largest known
+   abscissa below alpha, then hi is doubled until FS(hi) >= alpha, up to the bound of the
+   bracket (NAN beyond it).
+   Then a Newton step, with the density as derivative, is taken if it stays inside the
+   bracket and if the previous step has halved the bracket; otherwise the bracket is bisected. */
+static double solveQuantile(QuantileSolver* solver, double alpha, double* lo, double* Flo)
+{
+  InsuredClient* client = solver->client;
+  IntegrationConfig* integ = &solver->cfg->integ;
+  double limit = integ->adaptive ? DBL_MAX : QUANTILE_MAX_STEPS*integ->dx;
+  double hi = fmin((*lo > 0) ? 2*(*lo) : exp(client->m + client->s), limit);
+  double Fhi = solverCDF_S(solver, hi);
+  for (int doublings = 0; Fhi < alpha; doublings++)
+  {
+    if (hi >= limit || doublings == QUANTILE_MAX_BRACKET)
+    {
+      return NAN;
+    }
+    *lo = hi;
+    *Flo = Fhi;
+    hi = fmin(2*hi, limit);
+    Fhi = solverCDF_S(solver, hi);
+  }
+  double a = *lo, Fa = *Flo;
+  double x = hi, Fx = Fhi;
+  double width = hi - a, lastWidth = 2*width;
+  for (int iter = 0; iter < QUANTILE_MAX_ITER; iter++)
+  {
+    if (fabs(Fx - alpha) <= 1e-14 || hi - a <= 1e-12*hi)
+    {
+      break;
+    }
+    double f = solverPDF_S(solver, x);
+    double next = (f > 0) ? x - (Fx - alpha)/f : NAN;
+    if (!(next > a && next < hi) || 2*width > lastWidth)
+    {
+      next = a + (hi - a)/2;
+    }
+    x = next;
+    Fx = solverCDF_S(solver, x);
+    if (Fx < alpha)
+    {
+      a = x;
+      Fa = Fx;
+    }
+    else
+    {
+      hi = x;
+    }
+    lastWidth = width;
+    width = hi - a;
+  }
+  /* The next quantile (higher alpha) is above a */
+  *lo = a;
+  *Flo = Fa;
+  return (fabs(Fx - alpha) <= 1e-14) ? x : hi;
+}
+
+typedef struct{
+  double alpha;
+  int index;
+} Level;
+
+static int compareLevels(const void* l1, const void* l2)
+{
+  double a1 = ((Level*) l1)->alpha, a2 = ((Level*) l2)->alpha;
+  return (a1 > a2) - (a1 < a2);
+}
+
+bool clientQuantile_S_batch_r(InsuredClient* client, double* alphas, int k, double* out, PfaConfig* cfg)
+{
+  INSTRUMENT_SCOPE("clientQuantile_S_batch_r");
+  if (client == NULL || k < 0)
+  {
+    return false;
+  }
+  /* The levels are solved in increasing order: each bracket starts at the previous quantile */
+  Level* levels = malloc((k+1) * sizeof(Level));
+  QuantileSolver solver;
+  if (levels == NULL || !initQuantileSolver(&solver, client, cfg))
+  {
+    free(levels);
+    return false;
+  }
+  for (int j = 0; j < k; j++)
+  {
+    levels[j].alpha = alphas[j];
+    levels[j].index = j;
+  }
+  qsort(levels, k, sizeof(Level), compareLevels);
+  double lo = 0.0, Flo = client->p[0];
+  for (int j = 0; j < k; j++)
+  {
+    double alpha = levels[j].alpha;
+    double q;
+    if (isnan(alpha) || alpha < 0 || alpha > 1)
+    {
+      q = NAN;
+    }
+    else if (alpha <= client->p[0])
+    {
+      q = 0.0; /* Mass p[0] at 0: FS(0) = p[0] */
+    }
+    else if (alpha >= 1)
+    {
+      q = INFINITY;
+    }
+    else
+    {
+      q = solveQuantile(&solver, alpha, &lo, &Flo);
+    }
+    out[levels[j].index] = q;
+  }
+  freeQuantileSolver(&solver);
+  free(levels);
+  return true;
+}
+
+bool clientQuantile_S_batch(InsuredClient* client, double* alphas, int k, double* out)
+{
+  return clientQuantile_S_batch_r(client, alphas, k, out, &pfaConfig);
+}
+
+double clientQuantile_S_r(InsuredClient* client, double alpha, PfaConfig* cfg)
+{
+  double q;
+  if (!clientQuantile_S_batch_r(client, &alpha, 1, &q, cfg))
+  {
+    return NAN;
+  }
+  return q;
+}
+
+double clientQuantile_S(InsuredClient* client, double alpha)
+{
+  return clientQuantile_S_r(client, alpha, &pfaConfig);
+}
@@ -31,6 +31,74 @@ typedef struct{
 } Option;
 
 
+/* A set of options stored as a structure of arrays: option i is
+   (type[i], S0[i], K[i], T[i], mu[i], sig[i]), for i = 0..n-1.
+   The values of each field are contiguous, which lets optionPriceBatch use vector instructions. */
+typedef struct{
+  int n;
+  OptionType* type;
+  double* S0;
+  double* K;
+  double* T;
+  double* mu;
+  double* sig;
+} OptionBatch;
+
+/* Same set of options in single precision (optionPriceBatchf): half the memory of an
+   OptionBatch, and twice as many options per vector instruction. */
+typedef struct{
+  int n;
+  OptionType* type;
+  float* S0;
+  float* K;
+  float* T;
+  float* mu;
+  float* sig;
+} OptionBatchf;
+
+/* Sampled cross-check of optionPriceBatchf against optionPriceBatch (checkPriceBatchf).
+   The drift of an option is |float price - double price| / (S0*exp(mu*T) + K), the double
+   price being computed from the same (float) inputs. */
+typedef struct{
+  int sampleEvery;   /* One option out of sampleEvery is priced again in double (>= 1) */
+  double threshold;  /* Alert when the drift of an option is larger */
+  long checked;      /* Results of the last check: options priced again, */
+  long alerts;       /* options whose drift is larger than threshold, */
+  double maxDrift;   /* largest drift, */
+  int firstAlert;    /* index of the first option in alert (-1 if none) */
+} PriceCheckf;
+
+
+/* Price of an option and its sensitivities (Greeks) */
+typedef struct{
+  double price;
+  double delta; /* d price / d S0 */
+  double gamma; /* d2 price / d S0^2 */
+  double vega;  /* d price / d sig */
+  double theta; /* - d price / d T (value lost when the expiry gets one unit of time closer) */
+} OptionGreeks;
+
+/* Greeks of a batch of options, as a structure of arrays (n = batch->n values in each) */
+typedef struct{
+  double* price;
+  double* delta;
+  double* gamma;
+  double* vega;
+  double* theta;
+} OptionGreeksBatch;
+
+
+/* Result of the inversion of a price by impliedVolBatch */
+typedef enum {
+  IV_OK=0,             /* out[i] is the volatility which gives the price */
+  IV_BELOW_INTRINSIC,  /* Price <= max(F-K, 0) (call) or max(K-F, 0) (put), F = S0*exp(mu*T):
+                          only sig = 0 or an arbitrage could give it */
+  IV_ABOVE_MAX,        /* Price >= F (call) or K (put): not reached by any volatility */
+  IV_NO_CONVERGENCE,   /* The iterations did not converge (out[i] is the last iterate) */
+  IV_INVALID           /* S0, K or T not > 0, or a value is NaN */
+} ImpliedVolStatus;
+
+
 /* Don't change this type. The functions about insurance take an argument of type InsuredClient *.  */
 typedef struct{
   /* m and s are the parameters of the log-normal distribution of random variables X1 and X2
@@ -43,11 +111,44 @@ typedef struct{
   double* p;
 } InsuredClient;
 
+/* Method used to compute PHI, the cumulative distribution function of N(0,1).
+   The bounds are on the absolute error |PHI(x) - exact value|, for every real x.
+*/
+typedef enum {
+  PHI_QUADRATURE=0, /* "quadrature" : 0.5 + integral of phi from 0 to x, with the integration
+                       configuration. Reference mode, the error depends on the formula and dt
+                       (gauss3 with dt=0.1 : < 1e-11). */
+  PHI_ERFC,         /* "erfc" : closed form 0.5*erfc(-x/sqrt(2)) from the C library (< 1e-15). */
+  PHI_TABLE         /* "table" : quintic Hermite interpolation of PHI, phi and phi' tabulated with
+                       a step 1/32 on [-8.5, 8.5] (< 1e-13, see tablePHI in vecmath.h). */
+} PhiMethod;
+
+/* Everything the pfa functions need for their computations.
+   The reentrant functions (suffix _r) take a PfaConfig * as last argument instead of
+   reading the global variables: two threads can then price or evaluate clients
+   at the same time, with the same or with different configurations.
+*/
+typedef struct{
+  IntegrationConfig integ; /* Quadrature formula and dt used by the integrations */
+  PhiMethod phiMethod;     /* How PHI is computed (PHI_QUADRATURE after init_integration) */
+  bool severityGrid;       /* clientCDF_X1X2 reads fX from a table (false after init_integration) */
+} PfaConfig;
+
+/* Counters of the cache of clientCDF_X1X2 (see init_cache) */
+typedef struct{
+  long hits;      /* Values found in the cache */
+  long misses;    /* Values computed (and then stored) */
+  long evictions; /* Values removed to make room, least recently used first */
+  int size;       /* Number of values in the cache */
+  int capacity;   /* Maximal number of values (0: no cache) */
+} CacheStats;
+
 #ifdef PFA_C
 
 /* Global variables (only visible in pfa.c) for the integration computations */
 QuadFormula pfaQF;
 double pfa_dt;
+PfaConfig pfaConfig; /* Same values as pfaQF and pfa_dt, used by the non reentrant functions */
 
 #else
 /* Initialize the integration variables.
@@ -57,18 +158,76 @@ double pfa_dt;
    - dt : a positive value, which will be used to decide the number of subdivisions of an 
           interval [a,b], when computing the integration.
           The number of subdivisions will be N such that (b-a)/N ~ dt
+   With quadrature = "adaptive", the integrals are computed by integrate_adaptive_r
+   (Gauss-Kronrod), and dt is the tolerance (absolute and relative) instead of a length.
 
    This functions sets the global variables pfaQF and pfa_dt to the values that you will use.
 */
 extern bool init_integration(char* quadrature, double dt);
 
+/* Select the method used by PHI (and hence by optionPrice and clientCDF_X).
+   Argument method can be "quadrature", "erfc" or "table" (see PhiMethod).
+   init_integration selects "quadrature": call init_phi after init_integration.
+*/
+extern bool init_phi(char* method);
+
 /* Normal distribution : density (phi) and cumulative distribution function (PHI) */
 extern double phi(double x);
 extern double PHI(double x);
 
+/* phi and clientPDF_X evaluated on arrays: y[i] = phi(x[i]) or clientPDF_X(client, x[i]).
+   They use the vector functions of vecmath.h (relative difference with phi and
+   clientPDF_X < 1e-14). x and y may be the same array. */
+extern void phi_batch(double* x, double* y, size_t n);
+/* phi_batch in single precision (vecExpf): relative error < 1.2e-7*(2 + x*x), the rounding
+   of -x*x/2 in float */
+extern void phi_batchf(float* x, float* y, size_t n);
+extern void clientPDF_X_batch(InsuredClient* client, double* x, double* y, size_t n);
+
 /* Finance function */
 extern double optionPrice(Option* opt);
 
+/* Prices of the batch->n options of batch: price[i] is the price of option i.
+   PHI is always computed with the "table" method, and log, exp and PHI with the vector
+   instructions selected in vecmath.h (AVX-512, AVX2, or scalar fallback). Whatever the
+   instruction set, |price[i] - optionPrice(option i)| <= 1e-12 * (S0*exp(mu*T) + K)
+   when optionPrice uses the "erfc" or "table" method.
+   Does not depend on the global variables: can be called by several threads. */
+extern void optionPriceBatch(OptionBatch* batch, double* price);
+
+/* optionPriceBatch in single precision (vecLogf, vecExpf, vecPHIf). If error is not NULL,
+   error[i] is an estimate of |price[i] - price of optionPriceBatch for the same inputs|,
+   from the rounding of z0 (amplified by 1/(sig*sqrt(T))), the error of vecPHIf and the
+   rounding of the final difference: typically 1e-7 to 1e-6 * (S0*exp(mu*T) + K).
+   Can be called by several threads. */
+extern void optionPriceBatchf(OptionBatchf* batch, float* price, float* error);
+
+/* Prices again in double one option out of check->sampleEvery of batch (price: result of
+   optionPriceBatchf) and fills the results of check. Returns false (alert) if the drift of
+   at least one of these options is larger than check->threshold. */
+extern bool checkPriceBatchf(OptionBatchf* batch, float* price, PriceCheckf* check);
+
+/* Price and Greeks in one evaluation of z0, phi and PHI. With F = S0*exp(mu*T),
+   d1 = sig*sqrt(T) - z0 and sgn = +1 (call) or -1 (put):
+     delta = sgn*exp(mu*T)*PHI(sgn*d1)      gamma = exp(mu*T)*phi(d1)/(S0*sig*sqrt(T))
+     vega  = F*phi(d1)*sqrt(T)              theta = -(sgn*mu*F*PHI(sgn*d1) + F*phi(d1)*sig/(2*sqrt(T)))
+   The price is the one of optionPrice. */
+extern void optionPriceAndGreeks(Option* opt, OptionGreeks* greeks);
+
+/* Same as optionPriceAndGreeks for the batch->n options of batch, with the vector functions
+   (same PHI and accuracy as optionPriceBatch). */
+extern void optionPriceAndGreeksBatch(OptionBatch* batch, OptionGreeksBatch* greeks);
+
+/* Implied volatilities: batch->sig[i] is set to the volatility for which the price of
+   option i (optionPrice) is prices[i], and status[i] tells if it was found.
+   The other fields of batch are read only. The initial guess is the rational approximation
+   of Corrado and Miller; then Halley steps use the analytic vega and its derivative, inside
+   a bracket which is bisected when a step leaves it. Each option stops as soon as it has
+   converged: the options still running are gathered in contiguous arrays, so that PHI and phi
+   are computed with the vector functions (as optionPriceBatch). Returns the number of
+   options whose status is not IV_OK (batch->sig[i] is then NAN, except for IV_NO_CONVERGENCE). */
+extern int impliedVolBatch(OptionBatch* batch, double* prices, ImpliedVolStatus* status);
+
 /* Insurance functions */
 extern double clientPDF_X(InsuredClient* client, double x);
 extern double clientCDF_X(InsuredClient* client, double x);
@@ -76,6 +235,75 @@ extern double clientPDF_X1X2(InsuredClient* client, double x);
 extern double clientCDF_X1X2(InsuredClient* client, double x);
 extern double clientCDF_S(InsuredClient* client, double x);
 
+/* Curves : out[j] = PHI(xs[j]), clientCDF_X(client, xs[j]), ... for j = 0..k-1.
+   The thresholds xs must be finite and sorted in increasing order (otherwise false is returned).
+   With the quadrature method, the integrals from 0 to all the thresholds are computed in
+   a single pass (integrate_cumulative), instead of k integrals from 0. */
+extern bool PHI_curve(double* xs, int k, double* out);
+extern bool clientCDF_X_curve(InsuredClient* client, double* xs, int k, double* out);
+extern bool clientCDF_X1X2_curve(InsuredClient* client, double* xs, int k, double* out);
+extern bool clientCDF_S_curve(InsuredClient* client, double* xs, int k, double* out);
+
+/* Quantiles of S: smallest x >= 0 such that clientCDF_S(client, x) >= alpha (the value at risk
+   at level alpha). S = 0 with probability p[0]: the quantile is 0 for alpha <= p[0].
+   It is INFINITY for alpha = 1, and NAN if alpha is not in [0,1]. It is also NAN when the
+   quantile is beyond 10000*dx (the cost of the integrals grows as (x/dx)^2), or beyond 2^64
+   times the first probe in adaptive mode: such tail levels fail instead of running for hours.
+   The equation is solved by Newton steps, with the density of S as derivative, inside a
+   bracket which is bisected when a step leaves it or converges too slowly. The values of the
+   CDF of X1+X2 already computed are kept: a new probe only integrates from the nearest one.
+   clientQuantile_S_batch computes out[j] for the k levels alphas[j] (in any order), each
+   bracket starting at the quantile of the previous level. It returns false if memory is missing. */
+extern double clientQuantile_S(InsuredClient* client, double alpha);
+extern bool clientQuantile_S_batch(InsuredClient* client, double* alphas, int k, double* out);
+
+/* Cache of the values of clientCDF_X1X2 (and hence of the part of clientCDF_S which
+   integrates twice). Many clients have the same parameters m and s, and the same thresholds
+   are evaluated again and again: the values are kept, with the key (m, s, x, quadrature
+   formula, dt) (or the tolerances in adaptive mode). p[] is not in the key, since clientCDF_S
+   only combines the values linearly with it. Other fields of the configuration, such as the
+   number of threads, change the value by rounding errors only and are not in the key.
+   init_cache(capacity) keeps up to capacity values, and removes the least recently used one
+   when it is full. There is no cache before the first call to init_cache, nor after
+   init_cache(0). The cache is shared by all the threads and all the configurations.
+   clear_cache removes all the values and sets the counters to 0.
+   The curves (clientCDF_X1X2_curve...) are computed in one pass and do not use the cache. */
+extern bool init_cache(int capacity);
+extern void clear_cache(void);
+extern void cache_stats(CacheStats* stats);
+
+/* Shared severity grid for clientCDF_X1X2 (and hence clientCDF_S), off by default.
+   The outer integral on [0,x] has N = round(x/dt) subdivisions of length h = x/N. With the
+   grid, the inner integral (density of X1+X2 at an outer node y) uses the same subdivisions
+   [jh, (j+1)h] up to y, plus a last shorter one: all the points t and y-t of these
+   subdivisions are of the form (k + c)*h, with c a node of the quadrature formula or a
+   difference of two nodes. fX is tabulated once on these points (O(N) evaluations of log
+   and exp with clientPDF_X_batch, instead of O(N^2)), the nested sums only read the table.
+   Same formula and dt, same order of accuracy as without the grid: the values differ by
+   the discretisation error (the inner subdivisions are aligned on the outer ones).
+   Not used in adaptive mode, by the curves and by the quantiles. */
+extern bool init_severity_grid(bool enabled);
+
+/* Reentrant versions of the functions above.
+   init_integration_r fills cfg, which is then only read by the other functions.
+   phi and clientPDF_X do not integrate anything, and are already reentrant. */
+extern bool init_integration_r(PfaConfig* cfg, char* quadrature, double dt);
+extern bool init_phi_r(PfaConfig* cfg, char* method);
+extern bool init_severity_grid_r(PfaConfig* cfg, bool enabled);
+extern double PHI_r(double x, PfaConfig* cfg);
+extern double optionPrice_r(Option* opt, PfaConfig* cfg);
+extern void optionPriceAndGreeks_r(Option* opt, OptionGreeks* greeks, PfaConfig* cfg);
+extern double clientCDF_X_r(InsuredClient* client, double x, PfaConfig* cfg);
+extern double clientPDF_X1X2_r(InsuredClient* client, double x, PfaConfig* cfg);
+extern double clientCDF_X1X2_r(InsuredClient* client, double x, PfaConfig* cfg);
+extern double clientCDF_S_r(InsuredClient* client, double x, PfaConfig* cfg);
+extern bool PHI_curve_r(double* xs, int k, double* out, PfaConfig* cfg);
+extern bool clientCDF_X_curve_r(InsuredClient* client, double* xs, int k, double* out, PfaConfig* cfg);
+extern bool clientCDF_X1X2_curve_r(InsuredClient* client, double* xs, int k, double* out, PfaConfig* cfg);
+extern bool clientCDF_S_curve_r(InsuredClient* client, double* xs, int k, double* out, PfaConfig* cfg);
+extern double clientQuantile_S_r(InsuredClient* client, double alpha, PfaConfig* cfg);
+extern bool clientQuantile_S_batch_r(InsuredClient* client, double* alphas, int k, double* out, PfaConfig* cfg);
+
 #endif // PFA_C
 
 #endif // PFA_H
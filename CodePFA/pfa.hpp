@@ -0,0 +1,201 @@
+/*************************************/
+/* Header file pfa.hpp               */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#ifndef PFA_HPP
+#define PFA_HPP
+
+#include <cmath>
+#include <cstddef>
+
+extern "C" {
+#include "integration.h"
+#include "pfa.h"
+}
+
+/* C++ interface (C++17, header only) to the integration functions, specialised at compile
+   time: the quadrature formula is a type whose nodes and weights are constexpr arrays, and
+   the integrand is any callable (a lambda for instance). The loop over the nodes has a
+   constant number of iterations and the integrand is inlined, instead of reading qf->n,
+   qf->x and qf->w and calling f through a pointer at each node.
+
+   The sums are done in the same order as the C functions, and the tables have the same
+   values bit for bit: the results are identical to integrate, integrate_r, integrate_batch
+   and clientCDF_X1X2_r (without cache nor grid, below the threshold of the blocked sum of
+   integrate_dx_r: 16*INTEGRATION_BLOCK subdivisions by default), when the C and C++ files
+   are compiled with the same floating point options (no -ffast-math, same FMA contraction).
+
+   Only the 7 fixed formulas exist as types; gaussN, lobattoN and clenshawN (tables
+   computed at run time) stay available through the C functions. */
+
+namespace pfa {
+
+/* Quadrature formulas: n nodes in [0,1] in increasing order, n weights of sum 1
+   (the values of buildFixedRule in integration.c) */
+struct Left {
+  static constexpr int n = 1;
+  static constexpr double x[1] = {0.0};
+  static constexpr double w[1] = {1.0};
+  static constexpr const char* name = "left";
+};
+
+struct Right {
+  static constexpr int n = 1;
+  static constexpr double x[1] = {1.0};
+  static constexpr double w[1] = {1.0};
+  static constexpr const char* name = "right";
+};
+
+struct Middle {
+  static constexpr int n = 1;
+  static constexpr double x[1] = {0.5};
+  static constexpr double w[1] = {1.0};
+  static constexpr const char* name = "middle";
+};
+
+struct Trapezes {
+  static constexpr int n = 2;
+  static constexpr double x[2] = {0.0, 1.0};
+  static constexpr double w[2] = {0.5, 0.5};
+  static constexpr const char* name = "trapezes";
+};
+
+struct Simpson {
+  static constexpr int n = 3;
+  static constexpr double x[3] = {0.0, 0.5, 1.0};
+  static constexpr double w[3] = {1.0/6.0, 2.0/3.0, 1.0/6.0};
+  static constexpr const char* name = "simpson";
+};
+
+/* 1/2 -+ 1/(2*sqrt(3)), rounded as in integration.c */
+struct Gauss2 {
+  static constexpr int n = 2;
+  static constexpr double x[2] = {0.21132486540518708, 0.7886751345948129};
+  static constexpr double w[2] = {0.5, 0.5};
+  static constexpr const char* name = "gauss2";
+};
+
+/* (1 -+ sqrt(3/5))/2, rounded as in integration.c */
+struct Gauss3 {
+  static constexpr int n = 3;
+  static constexpr double x[3] = {0.1127016653792583, 0.5, 0.8872983346207417};
+  static constexpr double w[3] = {5.0/18.0, 4.0/9.0, 5.0/18.0};
+  static constexpr const char* name = "gauss3";
+};
+
+/* Number of subdivisions of the integrate_dx functions (nbSubdivisions in integration.c) */
+inline int subdivisions(double a, double b, double dx)
+{
+  int N = (int) std::round( std::sqrt((b-a)*(b-a))/dx );
+  return (N < 1) ? 1 : N;
+}
+
+/* Same as integrate: f(x) returns a double */
+template<class Rule, class F>
+double integrate(F&& f, double a, double b, int N)
+{
+  double total=0;
+  double sub=(b-a)/N;
+  for (int i = 0; i < N; i++)
+  {
+    double ai=a+i*sub;
+    double bi=a+(i+1)*sub;
+    double summ=0;
+    for (int j = 0; j < Rule::n; j++)
+    {
+      summ+=Rule::w[j]*f(ai+(Rule::x[j]*(bi-ai)));
+    }
+    total+=(bi-ai)*summ;
+  }
+  return total;
+}
+
+template<class Rule, class F>
+double integrate_dx(F&& f, double a, double b, double dx)
+{
+  return integrate<Rule>(f, a, b, subdivisions(a, b, dx));
+}
+
+/* Same as integrate_batch: f(double* x, double* y, size_t n) sets y[i] = f(x[i]),
+   with n <= INTEGRATION_BATCH_NODES */
+template<class Rule, class F>
+double integrate_batch(F&& f, double a, double b, int N)
+{
+  double x[INTEGRATION_BATCH_NODES];
+  double y[INTEGRATION_BATCH_NODES];
+  constexpr int perBlock = INTEGRATION_BATCH_NODES/Rule::n;
+  double total=0;
+  double sub=(b-a)/N;
+  for (int first = 0; first < N; first += perBlock)
+  {
+    int last = (first+perBlock < N) ? first+perBlock : N;
+    int k = 0;
+    for (int i = first; i < last; i++)
+    {
+      double ai=a+i*sub;
+      double bi=a+(i+1)*sub;
+      for (int j = 0; j < Rule::n; j++)
+      {
+        x[k++] = ai+(Rule::x[j]*(bi-ai));
+      }
+    }
+    f(x, y, (size_t) k);
+    k = 0;
+    for (int i = first; i < last; i++)
+    {
+      double ai=a+i*sub;
+      double bi=a+(i+1)*sub;
+      double summ=0;
+      for (int j = 0; j < Rule::n; j++)
+      {
+        summ+=Rule::w[j]*y[k++];
+      }
+      total+=(bi-ai)*summ;
+    }
+  }
+  return total;
+}
+
+template<class Rule, class F>
+double integrate_dx_batch(F&& f, double a, double b, double dx)
+{
+  return integrate_batch<Rule>(f, a, b, subdivisions(a, b, dx));
+}
+
+/* Distribution function of X1+X2, the double integral of clientCDF_X1X2_r with the formula
+   Rule and the step dx: integral on [0, x] of y -> integral on [0, y] of fX(y-t)*fX(t) dt.
+   Both levels are specialised; fX is evaluated by blocks with clientPDF_X_batch. */
+template<class Rule>
+double clientCDF_X1X2(InsuredClient* client, double x, double dx)
+{
+  if (x <= 0)
+  {
+    return 0.0;
+  }
+  auto density = [client, dx](double y) {
+    if (y <= 0.0)
+    {
+      return 0.0;
+    }
+    auto product = [client, y](double* t, double* out, size_t n) {
+      double u[INTEGRATION_BATCH_NODES];
+      for (size_t i = 0; i < n; i++)
+      {
+        u[i] = y - t[i];
+      }
+      clientPDF_X_batch(client, u, u, n);
+      clientPDF_X_batch(client, t, out, n);
+      for (size_t i = 0; i < n; i++)
+      {
+        out[i] *= u[i];
+      }
+    };
+    return integrate_dx_batch<Rule>(product, 0.0, y, dx);
+  };
+  return integrate_dx<Rule>(density, 0.0, x, dx);
+}
+
+} /* namespace pfa */
+
+#endif /* PFA_HPP */
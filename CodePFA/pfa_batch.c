@@ -0,0 +1,586 @@
+/******************************************************/
+/* pfa_batch.c                                        */
+/* Prices a file of options with optionPriceBatch     */
+/* Creation date: 17 October, 2026                    */
+/*                                                    */
+/* Usage : pfa_batch.exe [-b] [-t threads]            */
+/*                       [-d digits] input output     */
+/*                                                    */
+/* CSV input (default): one option per line,          */
+/*   type,S0,K,T,mu,sig                               */
+/* with type call, put, C, P, 0 (call) or 1 (put).    */
+/* A first line starting with "type" is a header.     */
+/* Output: one price per line, with digits            */
+/* significant digits (17 by default), "nan" for an   */
+/* invalid line.                                      */
+/*                                                    */
+/* Binary input (-b): the 8 bytes "PFAOPT1\n", then   */
+/* records of 48 bytes in the byte order of the       */
+/* machine: int32 type (0 call, 1 put), 4 unused      */
+/* bytes, double S0, K, T, mu, sig.                   */
+/* Output: one double per record (8 bytes each).      */
+/*                                                    */
+/* The input is mapped in memory (mmap) and cut in    */
+/* chunks; each task of the thread pool parses,       */
+/* prices and formats one chunk. The results are      */
+/* written in order by a writer thread, while the     */
+/* next chunks are computed: at most 2 waves of       */
+/* chunks are in memory, whatever the size of the     */
+/* file. The throughput is written on stderr.         */
+/* -t is at most 4 threads per processor.             */
+/******************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+#include <time.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pfa.h"
+#include "threadpool.h"
+
+#define BINARY_MAGIC "PFAOPT1\n"
+#define BINARY_HEADER 8
+#define BINARY_RECORD 48
+/* Size of a chunk of the input: bytes of CSV, or records of the binary format */
+#define CSV_CHUNK (4 << 20)
+#define BINARY_CHUNK 65536
+/* Chunks per thread in a wave */
+#define CHUNKS_PER_THREAD 2
+/* Largest number of threads (-t), per processor */
+#define THREADS_PER_PROCESSOR 4
+
+/* One chunk: the options it contains, their prices and the formatted output */
+typedef struct{
+  int n;
+  int capacity;
+  OptionBatch batch;
+  double* price;
+  bool* invalidRow;  /* Invalid lines: priced with dummy inputs, then set to nan */
+  char* out;
+  size_t outSize;
+  size_t outCapacity;
+  long invalid;
+} Chunk;
+
+typedef struct{
+  char* data;        /* Mapped input */
+  size_t size;
+  bool binary;
+  int digits;
+  size_t nbChunks;
+  size_t first;      /* First chunk of the current wave */
+  Chunk* chunks;     /* Chunks of the current wave */
+} Job;
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+static void reserve(Chunk* c, int capacity)
+{
+  if (capacity <= c->capacity)
+  {
+    return;
+  }
+  c->capacity = capacity;
+  c->batch.type = realloc(c->batch.type, capacity*sizeof(OptionType));
+  c->batch.S0 = realloc(c->batch.S0, capacity*sizeof(double));
+  c->batch.K = realloc(c->batch.K, capacity*sizeof(double));
+  c->batch.T = realloc(c->batch.T, capacity*sizeof(double));
+  c->batch.mu = realloc(c->batch.mu, capacity*sizeof(double));
+  c->batch.sig = realloc(c->batch.sig, capacity*sizeof(double));
+  c->price = realloc(c->price, capacity*sizeof(double));
+  c->invalidRow = realloc(c->invalidRow, capacity*sizeof(bool));
+}
+
+static void freeChunk(Chunk* c)
+{
+  free(c->batch.type);
+  free(c->batch.S0);
+  free(c->batch.K);
+  free(c->batch.T);
+  free(c->batch.mu);
+  free(c->batch.sig);
+  free(c->price);
+  free(c->invalidRow);
+  free(c->out);
+}
+
+/* ==========================================================*/
+/* Parsing                                                   */
+
+/* Marks option i as invalid. Its fields may be partly parsed or uninitialised: they are
+   replaced by finite inputs, so that no garbage reaches optionPriceBatch, and its price is
+   set to nan after the pricing (setInvalidPrices). */
+static void markInvalid(Chunk* c, int i)
+{
+  c->batch.type[i] = CALL;
+  c->batch.S0[i] = 1.0;
+  c->batch.K[i] = 1.0;
+  c->batch.T[i] = 1.0;
+  c->batch.mu[i] = 0.0;
+  c->batch.sig[i] = 1.0;
+  c->invalidRow[i] = true;
+  c->invalid++;
+}
+
+/* Exact powers of 10 in double */
+static const double powersOf10[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/* Reads a decimal number in [*p, end) and moves *p after it. Returns false if there is none.
+   With at most 15 significant digits and a decimal exponent in [-22, 22], the value is
+   m*10^e or m/10^e with m and 10^e exact: correctly rounded, as strtod. The other numbers
+   are read by strtod. */
+static bool parseDouble(char** p, char* end, double* value)
+{
+  char* s = *p;
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+'))
+  {
+    negative = (*s == '-');
+    s++;
+  }
+  unsigned long long m = 0;
+  int digits = 0, exponent = 0;
+  bool any = false;
+  while (s < end && *s >= '0' && *s <= '9')
+  {
+    if (m != 0 || *s != '0') digits++;
+    m = m*10 + (*s - '0');
+    any = true;
+    s++;
+    if (digits > 15) goto slow;
+  }
+  if (s < end && *s == '.')
+  {
+    s++;
+    while (s < end && *s >= '0' && *s <= '9')
+    {
+      if (m != 0 || *s != '0') digits++;
+      m = m*10 + (*s - '0');
+      exponent--;
+      any = true;
+      s++;
+      if (digits > 15) goto slow;
+    }
+  }
+  if (!any)
+  {
+    return false;
+  }
+  if (s < end && (*s == 'e' || *s == 'E'))
+  {
+    goto slow;
+  }
+  if (exponent < -22)
+  {
+    goto slow;
+  }
+  *value = (exponent < 0) ? (double) m/powersOf10[-exponent] : (double) m;
+  if (negative) *value = -*value;
+  *p = s;
+  return true;
+
+slow:
+  {
+    /* Copy of the field: the mapped file is not terminated by '\0' */
+    char field[64];
+    size_t len = 0;
+    for (s = *p; s < end && len < sizeof(field)-1 && *s != ',' && *s != '\r' && *s != '\n'; s++)
+    {
+      field[len++] = *s;
+    }
+    field[len] = '\0';
+    char* stop;
+    *value = strtod(field, &stop);
+    if (stop == field)
+    {
+      return false;
+    }
+    *p += stop - field;
+    return true;
+  }
+}
+
+static bool parseType(char** p, char* end, OptionType* type)
+{
+  char* s = *p;
+  char* field = s;
+  while (s < end && *s != ',' && *s != '\n' && *s != '\r')
+  {
+    s++;
+  }
+  size_t len = s - field;
+  if ((len == 4 && strncasecmp(field, "call", 4) == 0) || (len == 1 && (*field == 'C' || *field == 'c' || *field == '0')))
+  {
+    *type = CALL;
+  }
+  else if ((len == 3 && strncasecmp(field, "put", 3) == 0) || (len == 1 && (*field == 'P' || *field == 'p' || *field == '1')))
+  {
+    *type = PUT;
+  }
+  else
+  {
+    return false;
+  }
+  *p = s;
+  return true;
+}
+
+/* Parses one line of [*p, end) into option i of the chunk. *p is moved to the next line. */
+static bool parseLine(char** p, char* end, Chunk* c, int i)
+{
+  char* s = *p;
+  double* fields[5] = {&c->batch.S0[i], &c->batch.K[i], &c->batch.T[i], &c->batch.mu[i], &c->batch.sig[i]};
+  bool valid = parseType(&s, end, &c->batch.type[i]);
+  for (int f = 0; f < 5 && valid; f++)
+  {
+    valid = (s < end && *s == ',');
+    s++;
+    valid = valid && parseDouble(&s, end, fields[f]);
+  }
+  if (valid && s < end && *s == '\r')
+  {
+    s++;
+  }
+  valid = valid && (s == end || *s == '\n');
+  char* eol = memchr(*p, '\n', end - *p);
+  *p = (eol == NULL) ? end : eol + 1;
+  return valid;
+}
+
+/* Start of the first line beginning at or after offset: the lines of chunk k are the
+   lines starting in [k*CSV_CHUNK, (k+1)*CSV_CHUNK) */
+static size_t lineStart(Job* job, size_t offset)
+{
+  if (offset == 0)
+  {
+    return 0;
+  }
+  if (offset >= job->size)
+  {
+    return job->size;
+  }
+  char* eol = memchr(job->data + offset - 1, '\n', job->size - offset + 1);
+  return (eol == NULL) ? job->size : (size_t) (eol - job->data) + 1;
+}
+
+static void parseCsvChunk(Job* job, size_t k, Chunk* c)
+{
+  char* p = job->data + lineStart(job, k*CSV_CHUNK);
+  char* end = job->data + lineStart(job, (k+1)*CSV_CHUNK);
+  if (k == 0 && end - p >= 4 && strncasecmp(p, "type", 4) == 0)
+  {
+    char* eol = memchr(p, '\n', end - p);
+    p = (eol == NULL) ? end : eol + 1;
+  }
+  c->n = 0;
+  c->invalid = 0;
+  while (p < end)
+  {
+    if (*p == '\n' || *p == '\r')
+    {
+      p++; /* Empty line */
+      continue;
+    }
+    if (c->n == c->capacity)
+    {
+      reserve(c, (c->capacity == 0) ? 4096 : 2*c->capacity);
+    }
+    c->invalidRow[c->n] = false;
+    if (!parseLine(&p, end, c, c->n))
+    {
+      markInvalid(c, c->n);
+    }
+    c->n++;
+  }
+}
+
+static void parseBinaryChunk(Job* job, size_t k, Chunk* c)
+{
+  size_t records = (job->size - BINARY_HEADER)/BINARY_RECORD;
+  size_t first = k*BINARY_CHUNK;
+  c->n = (records - first < BINARY_CHUNK) ? (int) (records - first) : BINARY_CHUNK;
+  c->invalid = 0;
+  reserve(c, c->n);
+  char* record = job->data + BINARY_HEADER + first*BINARY_RECORD;
+  for (int i = 0; i < c->n; i++, record += BINARY_RECORD)
+  {
+    int32_t type;
+    memcpy(&type, record, sizeof(type));
+    memcpy(&c->batch.S0[i], record + 8, sizeof(double));
+    memcpy(&c->batch.K[i], record + 16, sizeof(double));
+    memcpy(&c->batch.T[i], record + 24, sizeof(double));
+    memcpy(&c->batch.mu[i], record + 32, sizeof(double));
+    memcpy(&c->batch.sig[i], record + 40, sizeof(double));
+    c->batch.type[i] = (type == 1) ? PUT : CALL;
+    c->invalidRow[i] = false;
+    if (type != 0 && type != 1)
+    {
+      markInvalid(c, i);
+    }
+  }
+}
+
+/* ==========================================================*/
+/* Pricing and formatting                                    */
+
+static void setInvalidPrices(Chunk* c)
+{
+  if (c->invalid == 0)
+  {
+    return;
+  }
+  for (int i = 0; i < c->n; i++)
+  {
+    if (c->invalidRow[i])
+    {
+      c->price[i] = NAN;
+    }
+  }
+}
+
+static void formatChunk(Job* job, Chunk* c)
+{
+  size_t capacity = job->binary ? c->n*sizeof(double) : (size_t) c->n*(job->digits + 10);
+  if (capacity > c->outCapacity)
+  {
+    c->outCapacity = capacity;
+    c->out = realloc(c->out, capacity);
+  }
+  if (job->binary)
+  {
+    memcpy(c->out, c->price, c->n*sizeof(double));
+    c->outSize = c->n*sizeof(double);
+    return;
+  }
+  char* s = c->out;
+  for (int i = 0; i < c->n; i++)
+  {
+    s += sprintf(s, "%.*g\n", job->digits, c->price[i]);
+  }
+  c->outSize = s - c->out;
+}
+
+static void chunkTask(int i, void* data)
+{
+  Job* job = (Job*) data;
+  Chunk* c = &job->chunks[i];
+  if (job->binary)
+  {
+    parseBinaryChunk(job, job->first + i, c);
+  }
+  else
+  {
+    parseCsvChunk(job, job->first + i, c);
+  }
+  c->batch.n = c->n;
+  optionPriceBatch(&c->batch, c->price);
+  setInvalidPrices(c);
+  formatChunk(job, c);
+}
+
+/* ==========================================================*/
+/* Writer thread: writes the waves in order                  */
+
+typedef struct{
+  FILE* file;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  Chunk* wave;       /* Wave to write, NULL when the writer is idle */
+  int nbChunks;
+  bool stop;
+  bool failed;
+  long records;
+  long invalid;
+} Writer;
+
+static void* writerThread(void* arg)
+{
+  Writer* w = (Writer*) arg;
+  pthread_mutex_lock(&w->lock);
+  for (;;)
+  {
+    while (w->wave == NULL && !w->stop)
+    {
+      pthread_cond_wait(&w->cond, &w->lock);
+    }
+    if (w->wave == NULL)
+    {
+      break;
+    }
+    Chunk* wave = w->wave;
+    int nbChunks = w->nbChunks;
+    pthread_mutex_unlock(&w->lock);
+    for (int i = 0; i < nbChunks; i++)
+    {
+      if (fwrite(wave[i].out, 1, wave[i].outSize, w->file) != wave[i].outSize)
+      {
+        w->failed = true;
+      }
+      w->records += wave[i].n;
+      w->invalid += wave[i].invalid;
+    }
+    pthread_mutex_lock(&w->lock);
+    w->wave = NULL;
+    pthread_cond_broadcast(&w->cond);
+  }
+  pthread_mutex_unlock(&w->lock);
+  return NULL;
+}
+
+/* Gives a wave to the writer, after the end of the previous one */
+static void writeWave(Writer* w, Chunk* wave, int nbChunks)
+{
+  pthread_mutex_lock(&w->lock);
+  while (w->wave != NULL)
+  {
+    pthread_cond_wait(&w->cond, &w->lock);
+  }
+  w->wave = wave;
+  w->nbChunks = nbChunks;
+  pthread_cond_broadcast(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+}
+
+/* ==========================================================*/
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: pfa_batch.exe [-b] [-t threads] [-d digits] input output\n");
+}
+
+int main(int argc, char** argv)
+{
+  bool binary = false;
+  int nthreads = nbProcessors();
+  int digits = 17;
+  int opt;
+  while ((opt = getopt(argc, argv, "bt:d:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'b': binary = true; break;
+      case 't': nthreads = atoi(optarg); break;
+      case 'd': digits = atoi(optarg); break;
+      default: usage(); return 2;
+    }
+  }
+  if (argc - optind != 2 || nthreads < 1 || digits < 1 || digits > 17)
+  {
+    usage();
+    return 2;
+  }
+  if (nthreads > THREADS_PER_PROCESSOR*nbProcessors())
+  {
+    nthreads = THREADS_PER_PROCESSOR*nbProcessors();
+    fprintf(stderr, "-t reduced to %d threads\n", nthreads);
+  }
+  char* input = argv[optind];
+  char* output = argv[optind+1];
+
+  double start = now();
+  int fd = open(input, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    fprintf(stderr, "%s can not be read\n", input);
+    return 1;
+  }
+  Job job = {NULL, st.st_size, binary, digits, 0, 0, NULL};
+  if (job.size > 0)
+  {
+    job.data = mmap(NULL, job.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (job.data == MAP_FAILED)
+    {
+      fprintf(stderr, "%s can not be mapped\n", input);
+      return 1;
+    }
+    madvise(job.data, job.size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+  if (binary)
+  {
+    if (job.size < BINARY_HEADER || memcmp(job.data, BINARY_MAGIC, BINARY_HEADER) != 0
+        || (job.size - BINARY_HEADER) % BINARY_RECORD != 0)
+    {
+      fprintf(stderr, "%s is not a binary file of options\n", input);
+      return 1;
+    }
+    size_t records = (job.size - BINARY_HEADER)/BINARY_RECORD;
+    job.nbChunks = (records + BINARY_CHUNK - 1)/BINARY_CHUNK;
+  }
+  else
+  {
+    job.nbChunks = (job.size + CSV_CHUNK - 1)/CSV_CHUNK;
+  }
+
+  Writer writer = {fopen(output, binary ? "wb" : "w"), PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                   NULL, 0, false, false, 0, 0};
+  if (writer.file == NULL)
+  {
+    fprintf(stderr, "%s can not be written\n", output);
+    return 1;
+  }
+
+  /* Two waves of chunks: one is computed while the other is written */
+  int waveSize = CHUNKS_PER_THREAD*nthreads;
+  Chunk* waves[2] = {calloc(waveSize, sizeof(Chunk)), calloc(waveSize, sizeof(Chunk))};
+  pthread_t writerId;
+  if (waves[0] == NULL || waves[1] == NULL || pthread_create(&writerId, NULL, writerThread, &writer) != 0)
+  {
+    fprintf(stderr, "%s: the writer can not be started\n", output);
+    free(waves[0]);
+    free(waves[1]);
+    fclose(writer.file);
+    return 1;
+  }
+  ThreadPool* pool = getThreadPool(nthreads);
+  int current = 0;
+  for (job.first = 0; job.first < job.nbChunks; job.first += waveSize)
+  {
+    int nbChunks = (job.nbChunks - job.first < (size_t) waveSize) ? (int) (job.nbChunks - job.first) : waveSize;
+    job.chunks = waves[current];
+    parallelFor(pool, nthreads, nbChunks, chunkTask, &job);
+    /* Returns when the previous wave (the other one) is written: it can be reused */
+    writeWave(&writer, waves[current], nbChunks);
+    current = 1 - current;
+  }
+
+  pthread_mutex_lock(&writer.lock);
+  writer.stop = true;
+  pthread_cond_broadcast(&writer.cond);
+  pthread_mutex_unlock(&writer.lock);
+  pthread_join(writerId, NULL);
+  bool failed = writer.failed | (fclose(writer.file) != 0);
+  if (job.data != NULL)
+  {
+    munmap(job.data, job.size);
+  }
+  for (int i = 0; i < waveSize; i++)
+  {
+    freeChunk(&waves[0][i]);
+    freeChunk(&waves[1][i]);
+  }
+  free(waves[0]);
+  free(waves[1]);
+
+  double elapsed = now() - start;
+  fprintf(stderr, "%ld records (%ld invalid) in %.3f s: %.0f records/s, %.1f MB/s, %d threads\n",
+          writer.records, writer.invalid, elapsed, writer.records/elapsed, job.size/elapsed/1e6, nthreads);
+  if (failed)
+  {
+    fprintf(stderr, "%s: write error\n", output);
+    return 1;
+  }
+  return 0;
+}
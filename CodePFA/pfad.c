@@ -0,0 +1,888 @@
+/******************************************************/
+/* pfad.c                                             */
+/* Pricing daemon on a Unix domain socket             */
+/* Creation date: 17 October, 2026                    */
+/*                                                    */
+/* Usage : pfad.exe [-t threads] [-w window]          */
+/*                  [-q quadrature] [-d dt]           */
+/*                  [-m phi method] [-c cache] socket */
+/*         pfad.exe -B clients [-n requests]          */
+/*                  [-k option|cdf] [-q quadrature]   */
+/*                  [-d dt] [-m phi method] socket    */
+/*                                                    */
+/* Serves the requests of pfad.h. One thread reads    */
+/* the requests of all the connections and groups     */
+/* them in batches: a batch is computed when it has   */
+/* PFAD_MAX_BATCH requests, or window microseconds    */
+/* (50 by default) after its first request.           */
+/* The options of a batch are priced together by      */
+/* optionPriceBatch. The clientCDF_S requests of a    */
+/* batch are grouped by client (one task of the       */
+/* thread pool per client), each distinct threshold   */
+/* being computed once, through the cache of          */
+/* clientCDF_X1X2 (-c values, 4096 by default), or    */
+/* as one curve (clientCDF_S_curve_r) with -c 0.      */
+/* The configuration (gauss3, dt=0.1, table by        */
+/* default) and the cache are set once for all the    */
+/* clients. The statistics are written on stderr at   */
+/* the end (SIGINT, SIGTERM).                         */
+/* Invalid requests (see pfad.h) get PFAD_INVALID.    */
+/* A connection is no longer read while more than     */
+/* PFAD_MAX_OUT bytes of responses wait for it.       */
+/* -t is at most 4 threads per processor. When       */
+/* memory is missing, a connection is refused and a   */
+/* request gets PFAD_INVALID: the daemon goes on.     */
+/*                                                    */
+/* With -B, runs clients threads sending requests     */
+/* requests each (10000 by default, options or        */
+/* clientCDF_S of 4 clients with -k cdf) to the       */
+/* daemon, then compares the throughput and the       */
+/* values with the same requests computed in this     */
+/* process (same -q -d -m as the daemon, no cache).   */
+/******************************************************/
+
+#define _GNU_SOURCE /* ppoll */
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "pfa.h"
+#include "threadpool.h"
+#include "pfad.h"
+
+/* Maximal number of requests of a batch */
+#define PFAD_MAX_BATCH 1024
+/* Maximal number of connections */
+#define PFAD_MAX_CONNECTIONS 1024
+/* Requests read at once from a connection */
+#define PFAD_IN_BUFFER (64*sizeof(PfadRequest))
+/* Responses waiting to be written to a connection beyond which its requests are no longer
+   read, until the client reads them: a client that never reads can not make the daemon
+   grow without bound */
+#define PFAD_MAX_OUT (64*1024*sizeof(PfadResponse))
+/* Largest number of threads of the pool (-t), per processor */
+#define PFAD_THREADS_PER_PROCESSOR 4
+/* Requests sent before reading the responses, with -B */
+#define PFAD_PIPELINE 32
+
+typedef struct{
+  int fd;               /* -1 once closed */
+  char in[PFAD_IN_BUFFER];
+  size_t inLen;
+  char* out;
+  size_t outStart;
+  size_t outLen;
+  size_t outCapacity;
+} Connection;
+
+/* A request waiting in the current batch */
+typedef struct{
+  Connection* conn;
+  PfadRequest req;
+  long long arrival;    /* ns */
+  PfadResponse resp;
+} Pending;
+
+static volatile sig_atomic_t stop = 0;
+static PfaConfig cfg;
+static ThreadPool* pool;
+static int nthreads;
+static bool useCache;
+
+static Connection* conns[PFAD_MAX_CONNECTIONS];
+static int nconns = 0;
+static Pending pending[PFAD_MAX_BATCH];
+static int npending = 0;
+
+static PfadStats stats;
+static double latencies[PFAD_LATENCIES];
+static long nlatencies = 0;
+
+static long long nowNs(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long) t.tv_sec*1000000000LL + t.tv_nsec;
+}
+
+static void onSignal(int sig)
+{
+  (void) sig;
+  stop = 1;
+}
+
+/* ==========================================================*/
+/* Statistics                                                */
+
+static int compareDoubles(const void* a, const void* b)
+{
+  double x = *(double*) a, y = *(double*) b;
+  return (x > y) - (x < y);
+}
+
+static void computeStats(PfadStats* s)
+{
+  *s = stats;
+  s->meanBatch = (stats.batches > 0) ? (double) stats.requests/stats.batches : 0.0;
+  long n = (nlatencies < PFAD_LATENCIES) ? nlatencies : PFAD_LATENCIES;
+  if (n == 0)
+  {
+    return;
+  }
+  double* sorted = malloc(n*sizeof(double));
+  if (sorted == NULL)
+  {
+    return; /* Counters without the latencies */
+  }
+  memcpy(sorted, latencies, n*sizeof(double));
+  qsort(sorted, n, sizeof(double), compareDoubles);
+  s->p50 = sorted[n/2];
+  s->p99 = sorted[(long) (0.99*(n-1))];
+  s->max = sorted[n-1];
+  free(sorted);
+}
+
+static void printStats(FILE* file)
+{
+  PfadStats s;
+  computeStats(&s);
+  fprintf(file, "%llu requests in %llu batches (%.1f per batch), %llu connections, "
+          "latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+          (unsigned long long) s.requests, (unsigned long long) s.batches, s.meanBatch,
+          (unsigned long long) s.connections, s.p50, s.p99, s.max);
+}
+
+/* ==========================================================*/
+/* Connections                                               */
+
+static void closeConnection(Connection* c)
+{
+  if (c->fd >= 0)
+  {
+    close(c->fd);
+    c->fd = -1;
+  }
+}
+
+static void appendOut(Connection* c, void* data, size_t n)
+{
+  if (c->fd < 0)
+  {
+    return; /* The client is gone: the response is dropped */
+  }
+  if (c->outLen + n > c->outCapacity)
+  {
+    if (c->outStart > 0)
+    {
+      memmove(c->out, c->out + c->outStart, c->outLen - c->outStart);
+      c->outLen -= c->outStart;
+      c->outStart = 0;
+    }
+    if (c->outLen + n > c->outCapacity)
+    {
+      c->outCapacity = 2*(c->outLen + n);
+      c->out = realloc(c->out, c->outCapacity);
+    }
+  }
+  memcpy(c->out + c->outLen, data, n);
+  c->outLen += n;
+}
+
+/* Bytes of responses not written yet */
+static size_t outBacklog(Connection* c)
+{
+  return c->outLen - c->outStart;
+}
+
+/* Writes what the socket accepts without blocking */
+static void flushOut(Connection* c)
+{
+  while (c->fd >= 0 && c->outStart < c->outLen)
+  {
+    ssize_t w = write(c->fd, c->out + c->outStart, c->outLen - c->outStart);
+    if (w > 0)
+    {
+      c->outStart += w;
+    }
+    else if (w < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else
+    {
+      if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+      {
+        closeConnection(c);
+      }
+      return;
+    }
+  }
+  c->outStart = c->outLen = 0;
+}
+
+/* Moves the complete requests of the input buffer to the batch, while there is room */
+static void extractRequests(Connection* c, long long arrival)
+{
+  size_t used = 0;
+  while (c->inLen - used >= sizeof(PfadRequest) && npending < PFAD_MAX_BATCH && outBacklog(c) < PFAD_MAX_OUT)
+  {
+    Pending* p = &pending[npending++];
+    p->conn = c;
+    memcpy(&p->req, c->in + used, sizeof(PfadRequest));
+    p->arrival = arrival;
+    used += sizeof(PfadRequest);
+  }
+  memmove(c->in, c->in + used, c->inLen - used);
+  c->inLen -= used;
+}
+
+static void readConnection(Connection* c, long long arrival)
+{
+  while (c->fd >= 0 && c->inLen < PFAD_IN_BUFFER && outBacklog(c) < PFAD_MAX_OUT)
+  {
+    ssize_t r = read(c->fd, c->in + c->inLen, PFAD_IN_BUFFER - c->inLen);
+    if (r > 0)
+    {
+      c->inLen += r;
+      extractRequests(c, arrival);
+    }
+    else if (r < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    else
+    {
+      if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+      {
+        closeConnection(c);
+      }
+      return;
+    }
+    if (npending == PFAD_MAX_BATCH)
+    {
+      return;
+    }
+  }
+}
+
+/* Removes the closed connections (when no request of the batch refers to them) */
+static void removeClosedConnections(void)
+{
+  int kept = 0;
+  for (int i = 0; i < nconns; i++)
+  {
+    if (conns[i]->fd < 0)
+    {
+      free(conns[i]->out);
+      free(conns[i]);
+    }
+    else
+    {
+      conns[kept++] = conns[i];
+    }
+  }
+  nconns = kept;
+}
+
+/* ==========================================================*/
+/* Batches                                                   */
+
+/* The clientCDF_S requests of a batch, sorted by client then threshold */
+static Pending* cdfRequests[PFAD_MAX_BATCH];
+/* Groups of requests of the same client: cdfRequests[groupStart[g] .. groupStart[g+1]-1] */
+static int groupStart[PFAD_MAX_BATCH+1];
+
+static int compareClients(const void* a, const void* b)
+{
+  double* x = (*(Pending**) a)->req.args;
+  double* y = (*(Pending**) b)->req.args;
+  for (int i = 0; i < 6; i++)
+  {
+    if (x[i] != y[i])
+    {
+      return (x[i] < y[i]) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+static bool sameClient(PfadRequest* a, PfadRequest* b)
+{
+  return memcmp(a->args, b->args, 5*sizeof(double)) == 0;
+}
+
+static bool finiteArgs(double* args)
+{
+  for (int i = 0; i < 6; i++)
+  {
+    if (!isfinite(args[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool validOption(double* args)
+{
+  return finiteArgs(args) && (args[0] == 0.0 || args[0] == 1.0)
+         && args[1] > 0.0 && args[2] > 0.0 && args[3] > 0.0 && args[5] > 0.0;
+}
+
+/* With a fixed formula, the threshold is bounded (see pfad.h): the cost of a request grows
+   as (x/dt)^2. In adaptive mode, dx is the tolerance and the cost is bounded by maxEvals. */
+static bool validClient(double* args)
+{
+  return finiteArgs(args) && args[1] > 0.0 && args[2] >= 0.0 && args[3] >= 0.0 && args[4] >= 0.0
+         && fabs(args[2] + args[3] + args[4] - 1.0) < 1e-9
+         && (cfg.integ.adaptive || fabs(args[5]) <= PFAD_MAX_STEPS*cfg.integ.dx);
+}
+
+/* Requests of one client, sorted by threshold: each distinct threshold is computed once.
+   With the cache, each one is a clientCDF_S_r (the frequent thresholds are then found in
+   the cache), without it, they are one curve. */
+static void cdfGroupTask(int g, void* data)
+{
+  (void) data;
+  Pending** group = cdfRequests + groupStart[g];
+  int k = groupStart[g+1] - groupStart[g];
+  double* args = group[0]->req.args;
+  double p[3] = {args[2], args[3], args[4]};
+  InsuredClient client = {args[0], args[1], p};
+  double* xs = malloc(2*k*sizeof(double));
+  if (xs == NULL)
+  {
+    for (int j = 0; j < k; j++)
+    {
+      group[j]->resp.status = PFAD_INVALID;
+    }
+    return;
+  }
+  double* out = xs + k;
+  int nxs = 0;
+  for (int j = 0; j < k; j++)
+  {
+    if (nxs == 0 || group[j]->req.args[5] != xs[nxs-1])
+    {
+      xs[nxs++] = group[j]->req.args[5];
+    }
+  }
+  if (useCache || nxs == 1)
+  {
+    for (int j = 0; j < nxs; j++)
+    {
+      out[j] = clientCDF_S_r(&client, xs[j], &cfg);
+    }
+  }
+  else
+  {
+    clientCDF_S_curve_r(&client, xs, nxs, out, &cfg);
+  }
+  for (int j = 0, i = 0; j < k; j++)
+  {
+    while (xs[i] != group[j]->req.args[5])
+    {
+      i++;
+    }
+    group[j]->resp.value = out[i];
+  }
+  free(xs);
+}
+
+static void processBatch(void)
+{
+  static OptionType type[PFAD_MAX_BATCH];
+  static double S0[PFAD_MAX_BATCH], K[PFAD_MAX_BATCH], T[PFAD_MAX_BATCH], mu[PFAD_MAX_BATCH], sig[PFAD_MAX_BATCH];
+  static double price[PFAD_MAX_BATCH];
+  static Pending* options[PFAD_MAX_BATCH];
+  OptionBatch batch = {0, type, S0, K, T, mu, sig};
+  int ncdf = 0;
+
+  for (int i = 0; i < npending; i++)
+  {
+    Pending* p = &pending[i];
+    double* a = p->req.args;
+    p->resp.tag = p->req.tag;
+    p->resp.status = PFAD_OK;
+    p->resp.value = NAN;
+    if (p->req.kind == PFAD_OPTION_PRICE && validOption(a))
+    {
+      int j = batch.n++;
+      options[j] = p;
+      type[j] = (a[0] == 0.0) ? CALL : PUT;
+      S0[j] = a[1];
+      K[j] = a[2];
+      T[j] = a[3];
+      mu[j] = a[4];
+      sig[j] = a[5];
+    }
+    else if (p->req.kind == PFAD_CLIENT_CDF_S && validClient(a))
+    {
+      cdfRequests[ncdf++] = p;
+    }
+    else if (p->req.kind != PFAD_STATS)
+    {
+      p->resp.status = PFAD_INVALID;
+    }
+  }
+
+  optionPriceBatch(&batch, price);
+  for (int j = 0; j < batch.n; j++)
+  {
+    options[j]->resp.value = price[j];
+  }
+
+  if (ncdf > 0)
+  {
+    qsort(cdfRequests, ncdf, sizeof(Pending*), compareClients);
+    int ngroups = 0;
+    for (int i = 0; i < ncdf; i++)
+    {
+      if (i == 0 || !sameClient(&cdfRequests[i]->req, &cdfRequests[i-1]->req))
+      {
+        groupStart[ngroups++] = i;
+      }
+    }
+    groupStart[ngroups] = ncdf;
+    parallelFor(pool, nthreads, ngroups, cdfGroupTask, NULL);
+  }
+
+  /* Responses in the order of the requests of each connection */
+  long long end = nowNs();
+  stats.requests += npending;
+  stats.batches++;
+  for (int i = 0; i < npending; i++)
+  {
+    Pending* p = &pending[i];
+    latencies[nlatencies++ % PFAD_LATENCIES] = (end - p->arrival)/1000.0;
+    appendOut(p->conn, &p->resp, sizeof(PfadResponse));
+    if (p->req.kind == PFAD_STATS)
+    {
+      PfadStats s;
+      computeStats(&s);
+      appendOut(p->conn, &s, sizeof(PfadStats));
+    }
+  }
+  npending = 0;
+  for (int i = 0; i < nconns; i++)
+  {
+    flushOut(conns[i]);
+  }
+  removeClosedConnections();
+}
+
+/* ==========================================================*/
+/* Server                                                    */
+
+static int openSocket(char* path, bool listening)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    fprintf(stderr, "%s: path too long\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  if (listening)
+  {
+    unlink(path);
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 128) != 0)
+    {
+      close(fd);
+      return -1;
+    }
+  }
+  else if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static void acceptConnections(int listenFd)
+{
+  for (;;)
+  {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0)
+    {
+      return;
+    }
+    if (nconns == PFAD_MAX_CONNECTIONS)
+    {
+      close(fd);
+      continue;
+    }
+    Connection* c = calloc(1, sizeof(Connection));
+    if (c == NULL)
+    {
+      close(fd); /* Refused as beyond PFAD_MAX_CONNECTIONS */
+      continue;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    c->fd = fd;
+    conns[nconns++] = c;
+    stats.connections++;
+  }
+}
+
+static int serve(char* path, long long window)
+{
+  int listenFd = openSocket(path, true);
+  if (listenFd < 0)
+  {
+    fprintf(stderr, "%s: can not listen\n", path);
+    return 1;
+  }
+  fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  /* The signals are only received in ppoll: stop is then always seen */
+  sigset_t blocked, unblocked;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGINT);
+  sigaddset(&blocked, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &blocked, &unblocked);
+  fprintf(stderr, "pfad: listening on %s, %d threads\n", path, nthreads);
+
+  static struct pollfd fds[PFAD_MAX_CONNECTIONS+1];
+  while (!stop)
+  {
+    long long now = nowNs();
+    /* Requests left in the buffers by a full batch */
+    for (int i = 0; i < nconns && npending < PFAD_MAX_BATCH; i++)
+    {
+      extractRequests(conns[i], now);
+    }
+    if (npending == PFAD_MAX_BATCH || (npending > 0 && now - pending[0].arrival >= window))
+    {
+      processBatch();
+      continue;
+    }
+
+    fds[0].fd = listenFd;
+    fds[0].events = POLLIN;
+    for (int i = 0; i < nconns; i++)
+    {
+      fds[i+1].fd = conns[i]->fd;
+      fds[i+1].events = ((outBacklog(conns[i]) < PFAD_MAX_OUT) ? POLLIN : 0)
+                        | ((outBacklog(conns[i]) > 0) ? POLLOUT : 0);
+    }
+    int n = nconns;
+    struct timespec timeout;
+    long long wait = (npending > 0) ? pending[0].arrival + window - now : 0;
+    timeout.tv_sec = wait/1000000000LL;
+    timeout.tv_nsec = wait%1000000000LL;
+    if (ppoll(fds, n+1, (npending > 0) ? &timeout : NULL, &unblocked) < 0)
+    {
+      continue; /* EINTR: stop is checked */
+    }
+    now = nowNs();
+    for (int i = 0; i < n; i++)
+    {
+      if (fds[i+1].revents & (POLLIN | POLLHUP | POLLERR))
+      {
+        readConnection(conns[i], now);
+      }
+      if (fds[i+1].revents & POLLOUT)
+      {
+        flushOut(conns[i]);
+      }
+    }
+    if (fds[0].revents & POLLIN)
+    {
+      acceptConnections(listenFd);
+    }
+    if (npending == 0)
+    {
+      removeClosedConnections();
+    }
+  }
+
+  if (npending > 0)
+  {
+    processBatch();
+  }
+  for (int i = 0; i < nconns; i++)
+  {
+    closeConnection(conns[i]);
+  }
+  removeClosedConnections();
+  close(listenFd);
+  unlink(path);
+  printStats(stderr);
+  return 0;
+}
+
+/* ==========================================================*/
+/* Load generator (-B)                                       */
+
+typedef struct{
+  char* path;
+  int kind;
+  long requests;
+  long errors;
+  double* values;       /* Values received (client 0 only) */
+} LoadClient;
+
+static bool readAll(int fd, void* data, size_t n)
+{
+  char* p = (char*) data;
+  while (n > 0)
+  {
+    ssize_t r = read(fd, p, n);
+    if (r <= 0)
+    {
+      if (r < 0 && errno == EINTR) continue;
+      return false;
+    }
+    p += r;
+    n -= r;
+  }
+  return true;
+}
+
+static bool writeAll(int fd, void* data, size_t n)
+{
+  char* p = (char*) data;
+  while (n > 0)
+  {
+    ssize_t w = write(fd, p, n);
+    if (w <= 0)
+    {
+      if (w < 0 && errno == EINTR) continue;
+      return false;
+    }
+    p += w;
+    n -= w;
+  }
+  return true;
+}
+
+/* Request number i of the load: options with various strikes, expiries and volatilities,
+   or thresholds of 4 clients (the same clients for all the connections) */
+static void loadRequest(int kind, long i, PfadRequest* req)
+{
+  req->kind = kind;
+  req->tag = (uint32_t) i;
+  if (kind == PFAD_OPTION_PRICE)
+  {
+    double args[6] = {(double) (i % 2), 100.0, 80.0 + (i % 41), 0.25 + (i % 8)*0.25, 0.03, 0.1 + (i % 5)*0.05};
+    memcpy(req->args, args, sizeof(args));
+  }
+  else
+  {
+    double args[6] = {6.0 + (i % 4)*0.5, 1.0 + (i % 4)*0.25, 0.7, 0.25, 0.05, 500.0*(1 + (i/4) % 8)};
+    memcpy(req->args, args, sizeof(args));
+  }
+}
+
+/* Value of the request computed in this process, as each client would without the daemon */
+static double localValue(PfadRequest* req, PfaConfig* local)
+{
+  double* a = req->args;
+  if (req->kind == PFAD_OPTION_PRICE)
+  {
+    Option opt = {(a[0] == 0.0) ? CALL : PUT, a[1], a[2], a[3], a[4], a[5]};
+    return optionPrice_r(&opt, local);
+  }
+  double p[3] = {a[2], a[3], a[4]};
+  InsuredClient client = {a[0], a[1], p};
+  return clientCDF_S_r(&client, a[5], local);
+}
+
+static void* loadClient(void* arg)
+{
+  LoadClient* lc = (LoadClient*) arg;
+  int fd = openSocket(lc->path, false);
+  if (fd < 0)
+  {
+    lc->errors = lc->requests;
+    return NULL;
+  }
+  PfadRequest reqs[PFAD_PIPELINE];
+  PfadResponse resps[PFAD_PIPELINE];
+  for (long done = 0; done < lc->requests; )
+  {
+    int k = (lc->requests - done < PFAD_PIPELINE) ? (int) (lc->requests - done) : PFAD_PIPELINE;
+    for (int j = 0; j < k; j++)
+    {
+      loadRequest(lc->kind, done + j, &reqs[j]);
+    }
+    if (!writeAll(fd, reqs, k*sizeof(PfadRequest)) || !readAll(fd, resps, k*sizeof(PfadResponse)))
+    {
+      lc->errors += lc->requests - done;
+      break;
+    }
+    for (int j = 0; j < k; j++)
+    {
+      if (resps[j].tag != reqs[j].tag || resps[j].status != PFAD_OK)
+      {
+        lc->errors++;
+      }
+      if (lc->values != NULL)
+      {
+        lc->values[done + j] = resps[j].value;
+      }
+    }
+    done += k;
+  }
+  close(fd);
+  return NULL;
+}
+
+static int loadTest(char* path, int kind, int nclients, long requests, PfaConfig* local)
+{
+  LoadClient* lcs = calloc(nclients, sizeof(LoadClient));
+  pthread_t* ids = malloc(nclients*sizeof(pthread_t));
+  double* values = malloc(requests*sizeof(double));
+  if (lcs == NULL || ids == NULL || values == NULL)
+  {
+    fprintf(stderr, "not enough memory for %d clients of %ld requests\n", nclients, requests);
+    free(lcs);
+    free(ids);
+    free(values);
+    return 1;
+  }
+  long long start = nowNs();
+  int started = 0;
+  for (; started < nclients; started++)
+  {
+    LoadClient* lc = &lcs[started];
+    lc->path = path;
+    lc->kind = kind;
+    lc->requests = requests;
+    lc->values = (started == 0) ? values : NULL;
+    if (pthread_create(&ids[started], NULL, loadClient, lc) != 0)
+    {
+      fprintf(stderr, "%d clients started out of %d\n", started, nclients);
+      break;
+    }
+  }
+  /* The requests of the clients which could not be started are errors */
+  long errors = (long) (nclients - started)*requests;
+  for (int i = 0; i < started; i++)
+  {
+    pthread_join(ids[i], NULL);
+    errors += lcs[i].errors;
+  }
+  double elapsed = (nowNs() - start)/1e9;
+  double total = (double) nclients*requests;
+  printf("pfad      : %.0f requests in %.3f s, %.0f requests/s, %ld errors\n", total, elapsed, total/elapsed, errors);
+
+  /* The same requests computed one at a time in this process (at most 1 s) */
+  double maxDiff = 0.0;
+  long calls = 0;
+  start = nowNs();
+  for (; calls < (long) total && (calls % 64 != 0 || nowNs() - start < 1000000000LL); calls++)
+  {
+    PfadRequest req;
+    loadRequest(kind, calls % requests, &req);
+    double value = localValue(&req, local);
+    if (calls < requests && errors == 0)
+    {
+      maxDiff = fmax(maxDiff, fabs(value - values[calls]));
+    }
+  }
+  elapsed = (nowNs() - start)/1e9;
+  printf("in process: %ld calls in %.3f s, %.0f calls/s; max |pfad - in process| = %.1e\n",
+         calls, elapsed, calls/elapsed, maxDiff);
+
+  int fd = openSocket(path, false);
+  PfadRequest req;
+  memset(&req, 0, sizeof(req));
+  req.kind = PFAD_STATS;
+  PfadResponse resp;
+  PfadStats s;
+  if (fd >= 0 && writeAll(fd, &req, sizeof(req)) && readAll(fd, &resp, sizeof(resp)) && readAll(fd, &s, sizeof(s)))
+  {
+    printf("pfad stats: %llu requests, %.1f per batch, latency p50 %.1f us, p99 %.1f us\n",
+           (unsigned long long) s.requests, s.meanBatch, s.p50, s.p99);
+  }
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+  free(lcs);
+  free(ids);
+  free(values);
+  return (errors == 0) ? 0 : 1;
+}
+
+/* ==========================================================*/
+
+static void usage(void)
+{
+  fprintf(stderr, "Usage: pfad.exe [-t threads] [-w window] [-q quadrature] [-d dt] [-m phi method] [-c cache] socket\n"
+                  "       pfad.exe -B clients [-n requests] [-k option|cdf] [-q quadrature] [-d dt] [-m phi method] socket\n");
+}
+
+int main(int argc, char** argv)
+{
+  nthreads = nbProcessors();
+  long long window = 50;
+  char* quadrature = "gauss3";
+  double dt = 0.1;
+  char* method = "table";
+  int cache = 4096;
+  int nclients = 0;
+  long requests = 10000;
+  int kind = PFAD_OPTION_PRICE;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:w:q:d:m:c:B:n:k:")) != -1)
+  {
+    switch (opt)
+    {
+      case 't': nthreads = atoi(optarg); break;
+      case 'w': window = atoll(optarg); break;
+      case 'q': quadrature = optarg; break;
+      case 'd': dt = atof(optarg); break;
+      case 'm': method = optarg; break;
+      case 'c': cache = atoi(optarg); break;
+      case 'B': nclients = atoi(optarg); break;
+      case 'n': requests = atol(optarg); break;
+      case 'k': kind = (strcmp(optarg, "cdf") == 0) ? PFAD_CLIENT_CDF_S : PFAD_OPTION_PRICE; break;
+      default: usage(); return 2;
+    }
+  }
+  if (argc - optind != 1 || nthreads < 1 || window < 0 || cache < 0 || nclients < 0 || requests < 1)
+  {
+    usage();
+    return 2;
+  }
+  if (!init_integration_r(&cfg, quadrature, dt) || !init_phi_r(&cfg, method))
+  {
+    fprintf(stderr, "invalid configuration\n");
+    return 2;
+  }
+  if (nclients > 0)
+  {
+    return loadTest(argv[optind], kind, nclients, requests, &cfg);
+  }
+  init_cache(cache);
+  useCache = (cache > 0);
+  if (nthreads > PFAD_THREADS_PER_PROCESSOR*nbProcessors())
+  {
+    nthreads = PFAD_THREADS_PER_PROCESSOR*nbProcessors();
+    fprintf(stderr, "pfad: -t reduced to %d threads\n", nthreads);
+  }
+  pool = getThreadPool(nthreads);
+  return serve(argv[optind], 1000*window);
+}
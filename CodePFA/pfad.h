@@ -0,0 +1,61 @@
+/*************************************/
+/* Header file pfad.h                */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdint.h>
+
+#ifndef PFAD_H
+#define PFAD_H
+
+/* Protocol of pfad, the pricing daemon (pfad.c), on a Unix domain (stream) socket.
+   A client sends fixed size requests (PfadRequest) and receives one response (PfadResponse)
+   per request, in the order of its requests. It can send many requests before reading the
+   responses: the daemon groups the requests of all its clients into batches.
+   All the fields are in the byte order of the machine (the socket is local). */
+
+/* Kinds of requests, and their arguments */
+#define PFAD_OPTION_PRICE 1  /* optionPrice: args = type (0 call, 1 put), S0, K, T, mu, sig */
+#define PFAD_CLIENT_CDF_S 2  /* clientCDF_S: args = m, s, p[0], p[1], p[2], x */
+#define PFAD_STATS 3         /* Statistics: the response is followed by a PfadStats */
+
+/* Valid arguments: all finite, and
+   - PFAD_OPTION_PRICE: type 0 or 1, S0, K, T, sig > 0;
+   - PFAD_CLIENT_CDF_S: s > 0, p[i] >= 0 of sum 1, and with a fixed formula
+     |x| <= PFAD_MAX_STEPS*dt (dt of the daemon, 0.1 by default): the cost of clientCDF_S
+     grows as (x/dt)^2. With -q adaptive (-d is then the tolerance), x is not bounded: the
+     cost of each integral is bounded by the maxEvals of the configuration. */
+#define PFAD_MAX_STEPS 100000
+
+/* Status of a response */
+#define PFAD_OK 0
+#define PFAD_INVALID 1       /* Unknown kind or invalid arguments: value is NAN */
+
+typedef struct{
+  uint32_t kind;
+  uint32_t tag;              /* Any value, copied in the response */
+  double args[6];
+} PfadRequest;
+
+typedef struct{
+  uint32_t status;
+  uint32_t tag;
+  double value;
+} PfadResponse;
+
+/* Counters of the daemon since its start. The latency of a request is the time from its
+   reading to the writing of its response, in microseconds, over the last PFAD_LATENCIES
+   requests. */
+typedef struct{
+  uint64_t requests;
+  uint64_t batches;
+  uint64_t connections;      /* Connections accepted */
+  double meanBatch;          /* Mean number of requests per batch */
+  double p50;
+  double p99;
+  double max;
+} PfadStats;
+
+#define PFAD_LATENCIES 65536
+
+#endif /* PFAD_H */
@@ -0,0 +1,143 @@
+/* Tests de pfa.hpp : formules spécialisées à la compilation, comparées aux fonctions C.
+   Compilation : make test_hpp (avec la bibliothèque build/release/libpfa.a) */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "pfa.hpp"
+
+static double f5(double x)
+{
+  return sin(x * x);
+}
+
+static double secondes(clock_t debut)
+{
+  return (double) (clock() - debut) / CLOCKS_PER_SEC;
+}
+
+/* ====================================================
+   TEST 1 : tables constexpr = tables de integration.c
+   ==================================================== */
+template<class Rule>
+static void comparer_table()
+{
+  QuadFormula qf;
+  setQuadFormula(&qf, (char*) Rule::name);
+  bool identique = (qf.n == Rule::n)
+                   && memcmp(qf.x, Rule::x, sizeof(Rule::x)) == 0
+                   && memcmp(qf.w, Rule::w, sizeof(Rule::w)) == 0;
+  printf("  %-10s  %d noeud(s)  %s\n", Rule::name, Rule::n, identique ? "OUI (correct)" : "NON (erreur)");
+}
+
+static void test_tables()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 1 : tables constexpr identiques bit à bit               ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+  comparer_table<pfa::Left>();
+  comparer_table<pfa::Right>();
+  comparer_table<pfa::Middle>();
+  comparer_table<pfa::Trapezes>();
+  comparer_table<pfa::Simpson>();
+  comparer_table<pfa::Gauss2>();
+  comparer_table<pfa::Gauss3>();
+}
+
+/* ====================================================
+   TEST 2 : pfa::integrate<Rule> et integrate
+   ==================================================== */
+template<class Rule>
+static void comparer_integrate(int N)
+{
+  QuadFormula qf;
+  setQuadFormula(&qf, (char*) Rule::name);
+  clock_t debut = clock();
+  double ref = integrate(f5, -1.0, 4.0, N, &qf);
+  double t_c = secondes(debut);
+  debut = clock();
+  double res = pfa::integrate<Rule>([](double x) { return sin(x * x); }, -1.0, 4.0, N);
+  double t_cpp = secondes(debut);
+  printf("  %-10s  %-20.16f  %-14s  %-8.4f  %-8.4f\n", Rule::name, res,
+         (res == ref) ? "OUI (correct)" : "NON (erreur)", t_c, t_cpp);
+}
+
+static void test_integrate()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 2 : pfa::integrate<Rule> — sin(x²) sur [-1,4]           ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+  int N = 1000000;
+  printf("  N = %d\n", N);
+  printf("  %-10s  %-20s  %-14s  %-8s  %-8s\n", "formule", "pfa::integrate", "identique", "C (s)", "C++ (s)");
+  printf("  %s\n", "--------------------------------------------------------------------");
+  comparer_integrate<pfa::Left>(N);
+  comparer_integrate<pfa::Right>(N);
+  comparer_integrate<pfa::Middle>(N);
+  comparer_integrate<pfa::Trapezes>(N);
+  comparer_integrate<pfa::Simpson>(N);
+  comparer_integrate<pfa::Gauss2>(N);
+  comparer_integrate<pfa::Gauss3>(N);
+
+  /* Intégrande par tableaux : mêmes sommes que integrate_batch */
+  QuadFormula qf;
+  setQuadFormula(&qf, (char*) "gauss3");
+  auto tableau = [](double* x, double* y, size_t n) {
+    for (size_t i = 0; i < n; i++) y[i] = sin(x[i] * x[i]);
+  };
+  double res = pfa::integrate_batch<pfa::Gauss3>(tableau, -1.0, 4.0, 1000);
+  double ref = integrate_batch([](double* x, double* y, size_t n, void*) {
+    for (size_t i = 0; i < n; i++) y[i] = sin(x[i] * x[i]);
+  }, NULL, -1.0, 4.0, 1000, &qf);
+  printf("\n  integrate_batch<Gauss3>, N = 1000 : %.16f  %s\n", res,
+         (res == ref) ? "OUI (correct)" : "NON (erreur)");
+}
+
+/* ====================================================
+   TEST 3 : double intégrale de FX1+X2
+   ==================================================== */
+template<class Rule>
+static void comparer_X1X2(InsuredClient* client, double x, double dt)
+{
+  PfaConfig cfg;
+  init_integration_r(&cfg, (char*) Rule::name, dt);
+  clock_t debut = clock();
+  double ref = clientCDF_X1X2_r(client, x, &cfg);
+  double t_c = secondes(debut);
+  debut = clock();
+  double res = pfa::clientCDF_X1X2<Rule>(client, x, dt);
+  double t_cpp = secondes(debut);
+  printf("  %-10s  %-5.1f  %-16.12f  %-14s  %-8.4f  %-8.4f\n", Rule::name, dt, res,
+         (res == ref) ? "OUI (correct)" : "NON (erreur)", t_c, t_cpp);
+}
+
+static void test_X1X2()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 3 : pfa::clientCDF_X1X2<Rule> — FX1+X2(1000)            ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+  double probs[3] = {0.7, 0.25, 0.05};
+  InsuredClient client = {7.0, 1.5, probs};
+  printf("  %-10s  %-5s  %-16s  %-14s  %-8s  %-8s\n", "formule", "dt", "FX1+X2(1000)", "identique", "C (s)", "C++ (s)");
+  printf("  %s\n", "------------------------------------------------------------------------");
+  comparer_X1X2<pfa::Trapezes>(&client, 1000.0, 2.0);
+  comparer_X1X2<pfa::Simpson>(&client, 1000.0, 2.0);
+  comparer_X1X2<pfa::Gauss3>(&client, 1000.0, 2.0);
+  printf("  (attendu : résultats identiques à clientCDF_X1X2_r, sans cache ni grille)\n");
+}
+
+int main()
+{
+  printf("╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║          TESTS — INTERFACE C++ (pfa.hpp)                     ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n");
+
+  test_tables();
+  test_integrate();
+  test_X1X2();
+
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TOUS LES TESTS TERMINÉS                                      ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n");
+  return 0;
+}
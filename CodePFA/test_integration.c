@@ -26,6 +26,18 @@ double f4(double x) { return 1.0 / (1.0 + x * x); }
 /* f5(x) = sin(x²) => intégrale sur [-1,4] ~ 1.057402146  (pas de primitive simple) */
 double f5(double x) { return sin(x * x); }
 
+/* f5 pour integrate_dx_r et, évaluée sur un tableau, pour integrate_batch */
+static double f5_data(double x, void* data) { (void) data; return sin(x * x); }
+
+static int nb_appels = 0;
+
+static void f5_tableau(double* x, double* y, size_t n, void* data)
+{
+  (void) data;
+  nb_appels++;
+  for (size_t i = 0; i < n; i++) y[i] = sin(x[i] * x[i]);
+}
+
 /* ====================================================
    Utilitaires d'affichage
    ==================================================== */
@@ -198,6 +210,360 @@ void test_noms_invalides()
   printf("  setQuadFormula(\"gauss3\")  => %s  (attendu : true)\n",  ok ? "true" : "false");
 }
 
+/* ====================================================
+   Test 6 : integrate_r / integrate_dx_r — paramètre
+   transmis par le pointeur data (x^k sur [0,1])
+   ==================================================== */
+static double puissance(double x, void* data)
+{
+  int k = *(int*) data;
+  return pow(x, k);
+}
+
+void test_integrate_r()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 6 : integrate_r — x^k sur [0,1]  (exacte = 1/(k+1))    ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  IntegrationConfig cfg;
+  bool ok = setIntegrationConfig(&cfg, "simpson", 0.01);
+  printf("  setIntegrationConfig(\"simpson\", 0.01) => %s  (attendu : true)\n", ok ? "true" : "false");
+  ok = setIntegrationConfig(&cfg, "simpson", -1.0);
+  printf("  setIntegrationConfig(\"simpson\", -1)   => %s  (attendu : false)\n\n", ok ? "true" : "false");
+  setIntegrationConfig(&cfg, "simpson", 0.01);
+
+  printf("  k\tintegrate_r (N=100)\tintegrate_dx_r (dx=0.01)\tErreur\n");
+  printf("  %s\n", "------------------------------------------------------------------");
+  for (int k = 1; k <= 4; k++)
+  {
+    double r1 = integrate_r(puissance, &k, 0.0, 1.0, 100, &cfg.qf);
+    double r2 = integrate_dx_r(puissance, &k, 0.0, 1.0, &cfg);
+    printf("  %d\t%.10f\t\t%.10f\t\t\t%.2e\n", k, r1, r2, fabs(r2 - 1.0 / (k + 1)));
+  }
+}
+
+/* ====================================================
+   Test 7 : integrate_cumulative — intégrales de sin
+   de 0 à plusieurs bornes triées, en un seul passage
+   (exacte = 1 - cos(x))
+   ==================================================== */
+void test_integrate_cumulative()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 7 : integrate_cumulative — sin sur [0, x]               ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  QuadFormula qf;
+  setQuadFormula(&qf, "simpson");
+  double xs[] = {-0.5, 0.0, 0.05, 1.0, 1.234, 2.0, M_PI};
+  int    k    = 7;
+  double res[7];
+
+  bool ok = integrate_cumulative(f2, 0.0, xs, k, 0.01, &qf, res);
+  printf("  x\t\tcumulative\t\tintegrate_dx\t\tErreur (cumulative)\n");
+  printf("  %s\n", "------------------------------------------------------------------");
+  for (int j = 0; j < k; j++)
+  {
+    double un = integrate_dx(f2, 0.0, xs[j], 0.01, &qf);
+    printf("  %-8.4f\t%.10f\t\t%.10f\t\t%.2e\n", xs[j], res[j], un, fabs(res[j] - (1.0 - cos(xs[j]))));
+  }
+
+  double desordre[] = {1.0, 0.5};
+  bool ko = integrate_cumulative(f2, 0.0, desordre, 2, 0.01, &qf, res);
+  printf("\n  bornes triées => %s  (attendu : true)\n", ok ? "true" : "false");
+  printf("  bornes non triées => %s  (attendu : false)\n", ko ? "true" : "false");
+  double infinie[] = {1.0, INFINITY};
+  ko = integrate_cumulative(f2, 0.0, infinie, 2, 0.01, &qf, res);
+  printf("  borne infinie => %s  (attendu : false)\n", ko ? "true" : "false");
+  ko = integrate_cumulative(f2, 0.0, xs, k, 0.0, &qf, res);
+  printf("  dx = 0 => %s  (attendu : false)\n", ko ? "true" : "false");
+  ko = integrate_cumulative(f2, 0.0, xs, k, -0.01, &qf, res);
+  printf("  dx < 0 => %s  (attendu : false)\n", ko ? "true" : "false");
+}
+
+/* ====================================================
+   Test 8 : integrate_parallel — sin(x²) sur [-1,4]
+   Le résultat doit être identique (bit à bit) quel
+   que soit le nombre de threads.
+   ==================================================== */
+void test_integrate_parallel()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 8 : integrate_parallel — sin(x²) sur [-1,4], N=10^6     ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  QuadFormula qf;
+  setQuadFormula(&qf, "gauss3");
+  int N = 1000000;
+  double seq = integrate(f5, -1.0, 4.0, N, &qf);
+  double ref = integrate_parallel(f5, -1.0, 4.0, N, &qf, 1);
+  printf("  integrate (séquentiel)     %.16f\n", seq);
+  printf("  %-8s  %-20s  %-22s  %-10s\n", "threads", "valeur", "identique à 1 thread", "écart séquentiel");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  int threads[] = {1, 2, 3, 4, 8};
+  for (int i = 0; i < 5; i++)
+  {
+    double res = integrate_parallel(f5, -1.0, 4.0, N, &qf, threads[i]);
+    printf("  %-8d  %-20.16f  %-22s  %.2e\n", threads[i], res,
+           (res == ref) ? "OUI (correct)" : "NON (erreur)", fabs(res - seq));
+  }
+
+  /* Au-delà du seuil, integrate_dx_r et integrate_dx_batch font la somme par blocs quel que
+     soit le nombre de threads, même 1 : dx = 5e-6 donne N = 10^6 */
+  IntegrationConfig cfg;
+  setIntegrationConfig(&cfg, "gauss3", 5e-6);
+  int threadsDx[] = {1, 4};
+  for (int i = 0; i < 2; i++)
+  {
+    setIntegrationThreads(&cfg, threadsDx[i], 1000);
+    double res = integrate_dx_r(f5_data, NULL, -1.0, 4.0, &cfg);
+    double resBatch = integrate_dx_batch(f5_tableau, NULL, -1.0, 4.0, &cfg);
+    printf("  %-8s  %-20.16f  %-22s\n", (threadsDx[i] == 1) ? "dx_r 1" : "dx_r 4", res,
+           (res == ref) ? "OUI (correct)" : "NON (erreur)");
+    printf("  %-8s  %-20.16f  %-22s\n", (threadsDx[i] == 1) ? "batch 1" : "batch 4", resBatch,
+           (resBatch == ref) ? "OUI (correct)" : "NON (erreur)");
+  }
+
+  /* integrate_dx_r passe en parallèle au-delà du seuil */
+  setIntegrationThreads(&cfg, 4, 1000);
+  int k = 1;
+  double r = integrate_dx_r(puissance, &k, 0.0, 1.0, &cfg);
+  printf("\n  integrate_dx_r, 4 threads, x sur [0,1] : %.16f  (exacte : 0.5)\n", r);
+}
+
+/* ====================================================
+   Test 9 : integrate_adaptive — Gauss-Kronrod G7-K15
+   Nombre d'évaluations pour atteindre une tolérance,
+   comparé à gauss3 à pas fixe.
+   ==================================================== */
+
+/* f6 : pic étroit en 0.3, intégrale sur [0,1] = atan(700)/100 + atan(300)/100 */
+double f6(double x) { return 1.0 / (1.0 + 10000.0 * (x - 0.3) * (x - 0.3)); }
+
+void test_integrate_adaptive()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 9 : integrate_adaptive — tolérance au lieu de dx        ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  struct { char* nom; double (*f)(double); double a; double b; double exact; } cas[] = {
+    { "sin(x²) [-1,4]",  f5, -1.0, 4.0, 1.057402146 },
+    { "e^x [0,1]",       f3,  0.0, 1.0, exp(1.0) - 1.0 },
+    { "pic en 0.3",      f6,  0.0, 1.0, (atan(70.0) + atan(30.0)) / 100.0 },
+  };
+  double tols[] = {1e-6, 1e-10};
+
+  printf("  %-16s  %-8s  %-16s  %-10s  %-10s  %-8s\n",
+         "intégrale", "tol", "valeur", "err estim.", "err réelle", "évals");
+  printf("  %s\n", "--------------------------------------------------------------------------");
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 2; j++)
+    {
+      IntegrationResult res;
+      bool ok = integrate_adaptive(cas[i].f, cas[i].a, cas[i].b, tols[j], 0.0, 100000, &res);
+      printf("  %-16s  %-8.0e  %-16.12f  %-10.2e  %-10.2e  %-8d%s\n", cas[i].nom, tols[j], res.value,
+             res.error, fabs(res.value - cas[i].exact), res.evals, ok ? "" : "  (budget épuisé)");
+    }
+  }
+
+  /* gauss3 à pas fixe sur le pic : évaluations nécessaires pour 1e-10 */
+  QuadFormula qf;
+  setQuadFormula(&qf, "gauss3");
+  double exact = (atan(70.0) + atan(30.0)) / 100.0;
+  int N = 10;
+  while (fabs(integrate(f6, 0.0, 1.0, N, &qf) - exact) > 1e-10) N *= 2;
+  printf("\n  gauss3 à pas fixe, pic en 0.3, erreur < 1e-10 : N = %d, soit %d évaluations\n", N, 3 * N);
+
+  /* Budget trop petit : la tolérance n'est pas atteinte */
+  IntegrationResult res;
+  bool ok = integrate_adaptive(f6, 0.0, 1.0, 1e-14, 0.0, 100, &res);
+  printf("  Budget de 100 évaluations, tol 1e-14 => %s  (attendu : false), évals = %d\n",
+         ok ? "true" : "false", res.evals);
+}
+
+/* ====================================================
+   Test 10 : integrate_batch — intégrande évaluée sur
+   des tableaux de noeuds. Mêmes sommes, dans le même
+   ordre, que integrate : résultats identiques.
+   ==================================================== */
+void test_integrate_batch()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 10 : integrate_batch — sin(x²) sur [-1,4]               ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  char* formules[] = {"left", "trapezes", "simpson", "gauss3"};
+  printf("  %-10s  %-8s  %-20s  %-14s  %-12s\n", "formule", "N", "integrate_batch", "identique", "appels de f");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int j = 0; j < 4; j++)
+  {
+    QuadFormula qf;
+    setQuadFormula(&qf, formules[j]);
+    nb_appels = 0;
+    double res = integrate_batch(f5_tableau, NULL, -1.0, 4.0, 1000, &qf);
+    double ref = integrate(f5, -1.0, 4.0, 1000, &qf);
+    printf("  %-10s  %-8d  %-20.16f  %-14s  %d\n", formules[j], 1000, res,
+           (res == ref) ? "OUI (correct)" : "NON (erreur)", nb_appels);
+  }
+
+  /* integrate_dx_batch suit cfg->threads comme integrate_dx_r : mêmes blocs et même
+     réduction que integrate_parallel */
+  IntegrationConfig cfg;
+  setIntegrationConfig(&cfg, "gauss3", 5e-6);
+  setIntegrationThreads(&cfg, 4, 1000);
+  double par = integrate_dx_batch(f5_tableau, NULL, -1.0, 4.0, &cfg);
+  double ref = integrate_parallel(f5, -1.0, 4.0, 1000000, &cfg.qf, 4);
+  printf("\n  integrate_dx_batch, 4 threads, N=10^6 : %.16f  identique à integrate_parallel : %s\n",
+         par, (par == ref) ? "OUI (correct)" : "NON (erreur)");
+}
+
+/* ====================================================
+   TEST 11 : formules à N points (gaussN, lobattoN, clenshawN)
+   ==================================================== */
+void test_formules_N_points()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 11 : formules à N points — sin(x²) sur [-1,4]           ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  /* Référence : gauss64 avec 200 subdivisions */
+  QuadFormula qf;
+  setQuadFormula(&qf, "gauss64");
+  double ref = integrate(f5, -1.0, 4.0, 200, &qf);
+
+  char* formules[] = {"gauss1", "gauss3", "gauss10", "lobatto3", "lobatto10", "clenshaw3", "clenshaw17"};
+  printf("  %-12s  %-4s  %-20s  %-12s  %-12s\n", "formule", "N", "valeur", "erreur", "somme des w");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int j = 0; j < 7; j++)
+  {
+    setQuadFormula(&qf, formules[j]);
+    double somme = 0.0;
+    for (int i = 0; i < qf.n; i++)
+    {
+      somme += qf.w[i];
+    }
+    double res = integrate(f5, -1.0, 4.0, 20, &qf);
+    printf("  %-12s  %-4d  %-20.16f  %-12.3e  %.16f\n", qf.name, 20, res, fabs(res - ref), somme);
+  }
+  printf("  (erreurs attendues décroissantes avec le nombre de points, somme des w = 1)\n\n");
+
+  /* gauss3 de la table générale et gauss3 fixe donnent le même résultat */
+  QuadRule r = findQuadRule("gauss3");
+  printf("  findQuadRule(\"gauss3\")    = %d\n", r);
+  printf("  findQuadRule(\"gauss0\")    = %d  (attendu : -1)\n", findQuadRule("gauss0"));
+  printf("  findQuadRule(\"lobatto1\")  = %d  (attendu : -1)\n", findQuadRule("lobatto1"));
+  printf("  findQuadRule(\"gauss129\")  = %d  (attendu : -1)\n", findQuadRule("gauss129"));
+  printf("  findQuadRule(\"gauss05\")   = %d  (attendu : -1)\n", findQuadRule("gauss05"));
+  printf("  setQuadRule(gauss3)        => %s  (attendu : true)\n", setQuadRule(&qf, r) ? "true" : "false");
+  printf("  nom                        = %s\n\n", qf.name);
+
+  /* Exactitude polynomiale : x^(2N-1) pour gaussN, x^(2N-3) pour lobattoN, x^(N-1) pour clenshawN */
+  char* exactes[] = {"gauss10", "lobatto10", "clenshaw17"};
+  int degres[] = {19, 17, 16};
+  for (int j = 0; j < 3; j++)
+  {
+    setQuadFormula(&qf, exactes[j]);
+    double res = integrate_r(puissance, &degres[j], 0.0, 1.0, 1, &qf);
+    printf("  %-12s  x^%-2d sur [0,1], N = 1 : erreur = %.3e  (attendu : < 1e-15)\n", qf.name, degres[j], fabs(res - 1.0/(degres[j]+1)));
+  }
+}
+
+/* ====================================================
+   Test 12 : integrate_romberg — niveaux emboîtés
+   ==================================================== */
+void test_integrate_romberg()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 12 : integrate_romberg — trapèzes + Richardson         ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n");
+
+  double (*fonctions[])(double) = {f5, f3, f4, f6};
+  char* noms[] = {"sin(x²) [-1,4]", "exp(x) [0,1]", "1/(1+x²) [0,1]", "pic en 0.3 [0,1]"};
+  double bornes[][2] = {{-1.0, 4.0}, {0.0, 1.0}, {0.0, 1.0}, {0.0, 1.0}};
+  double exactes[] = {1.0574021463715, exp(1.0) - 1.0, M_PI / 4.0,
+                      (atan(70.0) + atan(30.0)) / 100.0};
+
+  printf("\n  %-18s  %-10s  %-10s  %-10s  %-8s  %s\n", "fonction", "tolérance", "erreur", "estimée", "évals", "convergé");
+  printf("  %s\n", "-------------------------------------------------------------------------");
+  for (int i = 0; i < 4; i++)
+  {
+    for (double tol = 1e-6; tol >= 1e-12; tol *= 1e-6)
+    {
+      IntegrationResult res;
+      bool ok = integrate_romberg(fonctions[i], bornes[i][0], bornes[i][1], 1, tol, 0.0, 1000000, &res);
+      printf("  %-18s  %-10.0e  %-10.2e  %-10.2e  %-8d  %s\n", noms[i], tol,
+             fabs(res.value - exactes[i]), res.error, res.evals, ok ? "oui" : "non");
+    }
+  }
+
+  /* Vérification de convergence à la manière du test 2 : integrate pour N, 2N, 4N, ...
+     jusqu'à ce que deux résultats successifs soient à moins de 1e-10 */
+  QuadFormula qf;
+  setQuadFormula(&qf, "trapezes");
+  double precedent = integrate(f5, -1.0, 4.0, 1, &qf);
+  long evalsRelances = 2;
+  for (int N = 2; N <= (1 << 20); N *= 2)
+  {
+    double valeur = integrate(f5, -1.0, 4.0, N, &qf);
+    evalsRelances += 2L * N; /* trapezes : 2 évaluations par subdivision */
+    if (fabs(valeur - precedent) <= 1e-10) break;
+    precedent = valeur;
+  }
+  IntegrationResult res;
+  integrate_romberg(f5, -1.0, 4.0, 1, 1e-10, 0.0, 1000000, &res);
+  printf("\n  sin(x²), tolérance 1e-10 :\n");
+  printf("  integrate(trapezes) à N, 2N, 4N... : %ld évaluations\n", evalsRelances);
+  printf("  integrate_romberg                  : %d évaluations, erreur %.2e\n",
+         res.evals, fabs(res.value - 1.0574021463715));
+  printf("  (attendu : Romberg beaucoup moins coûteux, erreur < 1e-10)\n");
+}
+
+/* ====================================================
+   TEST 13 : integrate_batchf — intégrande en float,
+   produits sommés en double
+   ==================================================== */
+static void f5_tableau_float(float* x, float* y, size_t n, void* data)
+{
+  (void) data;
+  for (size_t i = 0; i < n; i++) y[i] = sinf(x[i] * x[i]);
+}
+
+void test_integrate_batchf()
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 13 : integrate_batchf — simple précision                ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  char* formules[] = {"trapezes", "simpson", "gauss3"};
+  int Ns[] = {1000, 100000, 1000000};
+  printf("  %-10s  %-8s  %-12s  %-12s  %-12s\n", "formule", "N", "|float-double|", "estimée", "erreur exacte");
+  printf("  %s\n", "------------------------------------------------------------------");
+  for (int j = 0; j < 3; j++)
+  {
+    QuadFormula qf;
+    setQuadFormula(&qf, formules[j]);
+    for (int k = 0; k < 3; k++)
+    {
+      double estimee;
+      double res = integrate_batchf(f5_tableau_float, NULL, -1.0, 4.0, Ns[k], &qf, &estimee);
+      double ref = integrate_batch(f5_tableau, NULL, -1.0, 4.0, Ns[k], &qf);
+      printf("  %-10s  %-8d  %-12.2e  %-12.2e  %-12.2e\n", formules[j], Ns[k], fabs(res - ref), estimee,
+             fabs(res - 1.0574021463715));
+    }
+  }
+  printf("  (attendu : |float-double| < estimée ~ 1e-6, sans croissance avec N)\n");
+
+  /* Aucune subdivision : 0, comme integrate_batch */
+  QuadFormula qf;
+  setQuadFormula(&qf, "gauss3");
+  double estimee;
+  printf("\n  N = 0 : integrate_batchf = %g, integrate_batch = %g  (attendu : 0 et 0)\n",
+         integrate_batchf(f5_tableau_float, NULL, -1.0, 4.0, 0, &qf, &estimee),
+         integrate_batch(f5_tableau, NULL, -1.0, 4.0, 0, &qf));
+}
+
 /* ====================================================
    main
    ==================================================== */
@@ -212,6 +578,14 @@ int main()
   test_integrate_dx();
   test_exemple_specifications();
   test_noms_invalides();
+  test_integrate_r();
+  test_integrate_cumulative();
+  test_integrate_parallel();
+  test_integrate_adaptive();
+  test_integrate_batch();
+  test_formules_N_points();
+  test_integrate_romberg();
+  test_integrate_batchf();
 
   printf("\n╔══════════════════════════════════════════════════════════════╗\n");
   printf("║  TOUS LES TESTS TERMINÉS                                      ║\n");
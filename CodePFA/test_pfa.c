@@ -11,6 +11,15 @@
 
 #include "pfa.h"
 #include "integration.h"
+#include "convolution.h"
+#include "vecmath.h"
+#include "montecarlo.h"
+#include "instrument.h"
+#include "clientbook.h"
+#include <pthread.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
 
 /* ====================================================
    Utilitaire d'affichage
@@ -353,6 +362,1123 @@ void test_loi_S(void)
   printf("%s\n", ok ? "OUI (correct)" : "NON (erreur)");
 }
 
+/* ====================================================
+   TEST 6 : fonctions réentrantes (suffixe _r)
+   Chaque thread utilise sa propre PfaConfig : les
+   résultats doivent être identiques à ceux obtenus
+   séquentiellement avec la même configuration.
+   ==================================================== */
+typedef struct{
+  InsuredClient* client;
+  PfaConfig*     cfg;
+  double         x;
+  double         res;
+} TacheThread;
+
+static void* tache_cdf_X1X2(void* arg)
+{
+  TacheThread* t = (TacheThread*) arg;
+  t->res = clientCDF_X1X2_r(t->client, t->x, t->cfg);
+  return NULL;
+}
+
+void test_reentrant(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 6 : fonctions réentrantes (_r) et threads               ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  InsuredClient client;
+  client.m = 7.0;
+  client.s = 1.5;
+  double probs[3] = {0.7, 0.25, 0.05};
+  client.p = probs;
+
+  /* Deux configurations différentes, utilisées en même temps */
+  PfaConfig cfgA, cfgB;
+  init_integration_r(&cfgA, "gauss3", 5.0);
+  init_integration_r(&cfgB, "simpson", 10.0);
+
+  /* même configuration que la configuration globale => mêmes résultats */
+  printf("  Version globale et version _r (gauss3, dt=5.0)\n");
+  printf("  PHI(1.0)            : %.10f  /  %.10f\n", PHI(1.0), PHI_r(1.0, &cfgA));
+  printf("  clientCDF_S(1000)   : %.10f  /  %.10f\n",
+         clientCDF_S(&client, 1000.0), clientCDF_S_r(&client, 1000.0, &cfgA));
+
+  double seqA = clientCDF_X1X2_r(&client, 1000.0, &cfgA);
+  double seqB = clientCDF_X1X2_r(&client, 1000.0, &cfgB);
+
+  TacheThread taches[2] = {
+    { &client, &cfgA, 1000.0, 0.0 },
+    { &client, &cfgB, 1000.0, 0.0 },
+  };
+  pthread_t threads[2];
+  for (int i = 0; i < 2; i++)
+  {
+    pthread_create(&threads[i], NULL, tache_cdf_X1X2, &taches[i]);
+  }
+  for (int i = 0; i < 2; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  printf("\n  clientCDF_X1X2_r(1000) calculé dans 2 threads en parallèle\n");
+  printf("  %-22s  %-18s  %-18s\n", "configuration", "thread", "séquentiel");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  printf("  %-22s  %-18.10f  %-18.10f\n", "gauss3,  dt=5.0",  taches[0].res, seqA);
+  printf("  %-22s  %-18.10f  %-18.10f\n", "simpson, dt=10.0", taches[1].res, seqB);
+  printf("  Résultats identiques : %s\n",
+         (taches[0].res == seqA && taches[1].res == seqB) ? "OUI (correct)" : "NON (erreur)");
+
+  /* Intégrale extérieure répartie sur plusieurs threads (setIntegrationThreads) */
+  PfaConfig cfgP;
+  init_integration_r(&cfgP, "gauss3", 1.0);
+  setIntegrationThreads(&cfgP.integ, 2, 256);
+  double par2 = clientCDF_X1X2_r(&client, 1000.0, &cfgP);
+  setIntegrationThreads(&cfgP.integ, 4, 256);
+  double par4 = clientCDF_X1X2_r(&client, 1000.0, &cfgP);
+  printf("\n  clientCDF_X1X2_r(1000), dt=1.0, intégrale extérieure parallèle\n");
+  printf("  2 threads : %.12f   4 threads : %.12f   identiques : %s\n",
+         par2, par4, (par2 == par4) ? "OUI (correct)" : "NON (erreur)");
+}
+
+/* ====================================================
+   TEST 7 : méthodes de calcul de PHI
+   Erreur maximale sur [-10, 10] (pas 0.001), comparée
+   à la valeur de référence 0.5*erfc(-x/sqrt(2)), et
+   comparée aux valeurs exactes de la table N(0,1).
+   ==================================================== */
+void test_methodes_PHI(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 7 : méthodes de calcul de PHI                           ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  char* methodes[] = {"quadrature", "erfc", "table"};
+  char* bornes[]   = {"1e-11 (gauss3, dt=0.1)", "1e-15", "1e-13"};
+  double bornes_num[] = {1e-11, 1e-15, 1e-13};
+
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 0.1);
+  printf("  init_phi_r(\"Erfc\") => %s  (attendu : false)\n\n",
+         init_phi_r(&cfg, "Erfc") ? "true" : "false");
+
+  printf("  %-12s  %-16s  %-16s  %-24s\n", "méthode", "PHI(1.96)", "erreur max", "borne documentée");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int i = 0; i < 3; i++)
+  {
+    init_phi_r(&cfg, methodes[i]);
+    double err_max = 0.0;
+    for (int k = -10000; k <= 10000; k++)
+    {
+      double x   = k * 0.001;
+      double err = fabs(PHI_r(x, &cfg) - 0.5 * erfc(-x / sqrt(2.0)));
+      if (err > err_max) err_max = err;
+    }
+    double calc = PHI_r(1.96, &cfg);
+    printf("  %-12s  %-16.13f  %-16.2e  %-24s\n", methodes[i], calc, err_max, bornes[i]);
+    assert(err_max <= bornes_num[i]);
+    /* NaN est propagé par toutes les méthodes */
+    assert(isnan(PHI_r(NAN, &cfg)));
+  }
+  init_phi_r(&cfg, "table");
+  assert(PHI_r(INFINITY, &cfg) == 1.0 && PHI_r(-INFINITY, &cfg) == 0.0);
+  init_phi("table");
+  assert(isnan(PHI(NAN)));
+  init_phi("quadrature");
+  printf("  PHI(NAN) = %f pour les trois méthodes  (attendu : nan)\n", PHI_r(NAN, &cfg));
+
+  /* Les prix d'options ne dépendent pas (à 1e-10 près) de la méthode choisie */
+  printf("\n  Call (S0=100, K=100, T=1, mu=0.10, sig=0.3), exacte = 18.494078\n");
+  Option opt = { CALL, 100.0, 100.0, 1.0, 0.10, 0.3 };
+  for (int i = 0; i < 3; i++)
+  {
+    init_phi_r(&cfg, methodes[i]);
+    printf("  %-12s  %.10f\n", methodes[i], optionPrice_r(&opt, &cfg));
+  }
+}
+
+/* ====================================================
+   TEST 8 : loi de X1+X2 par FFT (m=7, s=1.5)
+   Grille de pas h sur [0, 20000] : une seule FFT pour
+   toute la courbe. Valeurs exactes : scipy (TEST 4-5).
+   ==================================================== */
+void test_convolution_fft(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 8 : loi de X1+X2 par convolution FFT                    ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  InsuredClient client;
+  client.m = 7.0;
+  client.s = 1.5;
+  double probs[3] = {0.7, 0.25, 0.05};
+  client.p = probs;
+
+  double pas[] = {4.0, 1.0, 0.25};
+  printf("  %-8s  %-16s  %-16s  %-16s\n", "h", "fX1+X2(1000)", "FX1+X2(1000)", "FX1+X2(5000)");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int i = 0; i < 3; i++)
+  {
+    double h = pas[i];
+    DiscreteDist* d = clientDist_X1X2(&client, h, (int) (20000.0 / h));
+    printf("  %-8.2f  %-16.8f  %-16.8f  %-16.8f\n", h,
+           discretePDF(d, 1000.0), discreteCDF(d, 1000.0), discreteCDF(d, 5000.0));
+    freeDiscreteDist(d);
+  }
+  printf("  %-8s  %-16.8f  %-16.8f  %-16.8f\n", "exacte", 0.00020807, 0.14962520, 0.64592068);
+
+  /* X seul : la discrétisation est exacte aux bords des cellules */
+  DiscreteDist* dX = clientDist_X(&client, 1.0, 20000);
+  printf("\n  FX(1000.5) par la grille : %.8f  (exact : %.8f)\n",
+         discreteCDF(dX, 1000.5), 0.5 * erfc(-(log(1000.5) - 7.0) / (1.5 * sqrt(2.0))));
+  freeDiscreteDist(dX);
+
+  /* X1+X2+X3 : somme de 3 sinistres, comparée à X1+X2 */
+  DiscreteDist* d2 = clientDist_Xk(&client, 2, 1.0, 20000);
+  DiscreteDist* d3 = clientDist_Xk(&client, 3, 1.0, 20000);
+  printf("  FX1+X2+X3(5000) = %.8f  <  FX1+X2(5000) = %.8f : %s\n",
+         discreteCDF(d3, 5000.0), discreteCDF(d2, 5000.0),
+         (discreteCDF(d3, 5000.0) < discreteCDF(d2, 5000.0)) ? "OUI (correct)" : "NON (erreur)");
+  freeDiscreteDist(d2);
+  freeDiscreteDist(d3);
+
+  /* k*n au-delà de la plus grande FFT : refusé sans allouer la grille */
+  DiscreteDist* dTrop = clientDist_Xk(&client, 1 << 20, 1.0, 20000);
+  printf("  clientDist_Xk(k = 2^20, n = 20000) = %s  (attendu : NULL)\n", (dTrop == NULL) ? "NULL" : "non NULL");
+  assert(dTrop == NULL);
+}
+
+/* ====================================================
+   TEST 9 : courbes (seuils triés, un seul passage)
+   Comparaison avec les appels point par point.
+   ==================================================== */
+void test_courbes(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 9 : courbes PHI_curve et clientCDF_S_curve              ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 0.1);
+
+  double zs[] = {-2.0, -1.0, 0.5, 1.0, 1.96};
+  double phis[5];
+  PHI_curve_r(zs, 5, phis, &cfg);
+  printf("  %-8s  %-18s  %-18s  %-12s\n", "x", "PHI_curve", "PHI", "écart");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int j = 0; j < 5; j++)
+  {
+    double un = PHI_r(zs[j], &cfg);
+    printf("  %-8.2f  %-18.10f  %-18.10f  %.2e\n", zs[j], phis[j], un, fabs(phis[j] - un));
+  }
+
+  InsuredClient client;
+  client.m = 7.0;
+  client.s = 1.5;
+  double probs[3] = {0.7, 0.25, 0.05};
+  client.p = probs;
+
+  init_integration_r(&cfg, "gauss3", 5.0);
+  init_phi_r(&cfg, "erfc");
+  double xs[] = {-1.0, 100.0, 500.0, 1000.0, 2000.0, 5000.0};
+  double fs[6];
+  clientCDF_S_curve_r(&client, xs, 6, fs, &cfg);
+  printf("\n  clientCDF_S_curve (gauss3, dt=5.0, PHI erfc)\n");
+  printf("  %-8s  %-18s  %-18s  %-12s\n", "x", "courbe", "point par point", "écart");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int j = 0; j < 6; j++)
+  {
+    double un = clientCDF_S_r(&client, xs[j], &cfg);
+    printf("  %-8.0f  %-18.10f  %-18.10f  %.2e\n", xs[j], fs[j], un, fabs(fs[j] - un));
+  }
+  printf("  Valeurs exactes (scipy) : FS(1000) = 0.82635174, FS(5000) = 0.94332162\n");
+}
+
+/* ====================================================
+   TEST 10 : prix d'un lot d'options (optionPriceBatch)
+   1003 options pseudo-aléatoires, comparées une à une
+   à optionPrice_r (PHI "erfc") pour chaque jeu
+   d'instructions disponible.
+   ==================================================== */
+
+/* Générateur pseudo-aléatoire reproductible, valeurs dans [0,1[ */
+static double aleatoire(unsigned long long* etat)
+{
+  *etat = *etat * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (double) (*etat >> 11) / 9007199254740992.0;
+}
+
+void test_lot_options(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 10 : lot d'options (optionPriceBatch, SIMD)             ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  int n = 1003;
+  OptionType type[1003];
+  double S0[1003], K[1003], T[1003], mu[1003], sig[1003], prix[1003];
+  unsigned long long etat = 42;
+  for (int i = 0; i < n; i++)
+  {
+    type[i] = (i % 3 == 0) ? PUT : CALL;
+    S0[i]   = 50.0 + 100.0 * aleatoire(&etat);
+    K[i]    = 50.0 + 100.0 * aleatoire(&etat);
+    T[i]    = 0.05 + 3.0 * aleatoire(&etat);
+    mu[i]   = -0.05 + 0.15 * aleatoire(&etat);
+    sig[i]  = 0.05 + 0.6 * aleatoire(&etat);
+  }
+  OptionBatch lot = { n, type, S0, K, T, mu, sig };
+
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 0.1);
+  init_phi_r(&cfg, "erfc");
+
+  /* Précision de vecExp et vecLog par rapport à la bibliothèque C */
+  char* jeux[] = {"scalar", "avx2", "avx512"};
+  printf("  %-8s  %-14s  %-14s  %-22s\n", "jeu", "exp (err rel)", "log (err rel)", "prix : erreur / (F+K)");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int j = 0; j < 3; j++)
+  {
+    if (!setVecISA(jeux[j]))
+    {
+      printf("  %-8s  non disponible sur ce processeur\n", jeux[j]);
+      continue;
+    }
+    double x[2000], y[2000];
+    double err_exp = 0.0, err_log = 0.0;
+    for (int i = 0; i < 2000; i++) x[i] = -700.0 + 0.7 * i;
+    vecExp(x, y, 2000);
+    for (int i = 0; i < 2000; i++)
+    {
+      double e = fabs(y[i] - exp(x[i])) / exp(x[i]);
+      if (e > err_exp) err_exp = e;
+    }
+    for (int i = 0; i < 2000; i++) x[i] = 1e-300 * pow(10.0, 0.3 * i);
+    vecLog(x, y, 2000);
+    for (int i = 0; i < 2000; i++)
+    {
+      double e = fabs(y[i] - log(x[i])) / fabs(log(x[i]));
+      if (e > err_log) err_log = e;
+    }
+
+    optionPriceBatch(&lot, prix);
+    double err_prix = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+      Option opt = { type[i], S0[i], K[i], T[i], mu[i], sig[i] };
+      double e = fabs(prix[i] - optionPrice_r(&opt, &cfg)) / (S0[i] * exp(mu[i] * T[i]) + K[i]);
+      if (e > err_prix) err_prix = e;
+    }
+    printf("  %-8s  %-14.2e  %-14.2e  %-10.2e (borne 1e-12)\n", jeux[j], err_exp, err_log, err_prix);
+  }
+  setVecISA("auto");
+  printf("\n  Jeu d'instructions choisi automatiquement : %s\n", vecISAName(getVecISA()));
+
+  /* Entrées dégénérées (NaN, T=0 à la monnaie, sig ou T infini), dans les voies
+     vectorielles et dans la fin scalaire : nan comme optionPrice */
+  {
+    int m = 11;
+    OptionType ty[11];
+    double s0[11], k0[11], t0[11], m0[11], sg[11], px[11];
+    for (int i = 0; i < m; i++)
+    {
+      ty[i] = (i % 2) ? PUT : CALL;
+      s0[i] = 100.0; k0[i] = 90.0 + 2.0 * i; t0[i] = 1.0; m0[i] = 0.03; sg[i] = 0.2;
+    }
+    k0[1] = 100.0; t0[1] = 0.0;       /* 0/0 dans une voie vectorielle */
+    s0[2] = NAN;
+    sg[3] = INFINITY;
+    t0[5] = INFINITY;
+    k0[9] = 100.0; t0[9] = 0.0;       /* dans la fin scalaire (11 = 8 + 3 = 2*4 + 3) */
+    m0[10] = NAN;
+    OptionBatch degeneres = { m, ty, s0, k0, t0, m0, sg };
+    for (int j = 0; j < 3; j++)
+    {
+      if (!setVecISA(jeux[j])) continue;
+      optionPriceBatch(&degeneres, px);
+      for (int i = 0; i < m; i++)
+      {
+        Option opt = { ty[i], s0[i], k0[i], t0[i], m0[i], sg[i] };
+        double ref = optionPrice_r(&opt, &cfg);
+        assert(isnan(px[i]) == isnan(ref));
+        assert(isnan(ref) || fabs(px[i] - ref) <= 1e-12 * (s0[i] * exp(m0[i] * t0[i]) + k0[i]));
+      }
+    }
+    setVecISA("auto");
+    Option t_nul = { CALL, 100.0, 100.0, 0.0, 0.03, 0.2 };
+    OptionBatch une = { 1, &t_nul.type, &t_nul.S0, &t_nul.K, &t_nul.T, &t_nul.mu, &t_nul.sig };
+    optionPriceBatch(&une, px);
+    printf("  T=0 à la monnaie : lot %f, optionPrice %f  (attendu : nan, nan)\n",
+           px[0], optionPrice_r(&t_nul, &cfg));
+  }
+
+  /* phi_batch et clientPDF_X_batch comparées à phi et clientPDF_X */
+  InsuredClient client;
+  client.m = 7.0;
+  client.s = 1.5;
+  double probs[3] = {0.7, 0.25, 0.05};
+  client.p = probs;
+  double xs[1000], ys[1000], err_phi = 0.0, err_fX = 0.0;
+  for (int i = 0; i < 1000; i++) xs[i] = -8.0 + 0.016 * i;
+  phi_batch(xs, ys, 1000);
+  for (int i = 0; i < 1000; i++)
+  {
+    double e = fabs(ys[i] - phi(xs[i])) / phi(xs[i]);
+    if (e > err_phi) err_phi = e;
+  }
+  for (int i = 0; i < 1000; i++) xs[i] = -10.0 + 20.0 * i;
+  clientPDF_X_batch(&client, xs, ys, 1000);
+  for (int i = 0; i < 1000; i++)
+  {
+    double ref = clientPDF_X(&client, xs[i]);
+    double e = (ref > 0) ? fabs(ys[i] - ref) / ref : fabs(ys[i]);
+    if (e > err_fX) err_fX = e;
+  }
+  printf("  phi_batch : erreur relative max %.2e   clientPDF_X_batch : %.2e  (borne 1e-14)\n",
+         err_phi, err_fX);
+
+  /* Cas 3 du TEST 2 : call 27.510760, put 1.358228 */
+  OptionType t3[2] = {CALL, PUT};
+  double s3[2] = {120.0, 120.0}, k3[2] = {100.0, 100.0}, T3[2] = {1.0, 1.0};
+  double m3[2] = {0.05, 0.05}, sg3[2] = {0.2, 0.2}, p3[2];
+  OptionBatch lot3 = { 2, t3, s3, k3, T3, m3, sg3 };
+  optionPriceBatch(&lot3, p3);
+  printf("  Cas 3 : call = %.6f (exact 27.510760)  put = %.6f (exact 1.358228)\n", p3[0], p3[1]);
+}
+
+/* ====================================================
+   TEST 11 : intégration adaptative (init "adaptive")
+   dt est alors la tolérance de Gauss-Kronrod.
+   ==================================================== */
+void test_adaptatif(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 11 : intégration adaptative (tolérance 1e-10)           ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  PfaConfig cfg;
+  if (!init_integration_r(&cfg, "adaptive", 1e-10))
+  {
+    printf("  ERREUR : init_integration_r(\"adaptive\") a échoué\n");
+    return;
+  }
+
+  InsuredClient client;
+  client.m = 7.0;
+  client.s = 1.5;
+  double probs[3] = {0.7, 0.25, 0.05};
+  client.p = probs;
+
+  printf("  %-18s  %-18s  %-18s  %-12s\n", "fonction", "valeur calculée", "valeur exacte", "erreur");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  double v = PHI_r(1.96, &cfg);
+  printf("  %-18s  %-18.12f  %-18.12f  %.2e\n", "PHI(1.96)", v, 0.9750021048517795, fabs(v - 0.9750021048517795));
+  v = clientCDF_X_r(&client, 5000.0, &cfg);
+  printf("  %-18s  %-18.12f  %-18.12f  %.2e\n", "FX(5000)", v, 0.84410235, fabs(v - 0.84410235));
+  v = clientPDF_X1X2_r(&client, 1000.0, &cfg);
+  printf("  %-18s  %-18.12f  %-18.12f  %.2e\n", "fX1+X2(1000)", v, 0.00020807, fabs(v - 0.00020807));
+  v = clientCDF_X1X2_r(&client, 1000.0, &cfg);
+  printf("  %-18s  %-18.12f  %-18.12f  %.2e\n", "FX1+X2(1000)", v, 0.14962520, fabs(v - 0.14962520));
+  v = clientCDF_S_r(&client, 5000.0, &cfg);
+  printf("  %-18s  %-18.12f  %-18.12f  %.2e\n", "FS(5000)", v, 0.94332162, fabs(v - 0.94332162));
+  printf("  (valeurs exactes scipy à 1e-8 près)\n");
+}
+
+/* ====================================================
+   TEST 12 : cache de clientCDF_X1X2 (LRU)
+   ==================================================== */
+void test_cache(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 12 : cache de clientCDF_X1X2 (capacité 4)               ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 10.0);
+
+  /* Deux clients avec les mêmes (m, s) mais des probabilités différentes */
+  double probs1[3] = {0.7, 0.25, 0.05};
+  double probs2[3] = {0.5, 0.3, 0.2};
+  InsuredClient client1 = {7.0, 1.5, probs1};
+  InsuredClient client2 = {7.0, 1.5, probs2};
+
+  double sans1 = clientCDF_S_r(&client1, 1000.0, &cfg);
+  double sans2 = clientCDF_S_r(&client2, 1000.0, &cfg);
+
+  init_cache(4);
+  double avec1 = clientCDF_S_r(&client1, 1000.0, &cfg);
+  double avec2 = clientCDF_S_r(&client2, 1000.0, &cfg);
+  CacheStats stats;
+  cache_stats(&stats);
+  printf("  FS(1000) client 1 : %.15f  identique : %s\n", avec1, (avec1 == sans1) ? "OUI (correct)" : "NON (erreur)");
+  printf("  FS(1000) client 2 : %.15f  identique : %s\n", avec2, (avec2 == sans2) ? "OUI (correct)" : "NON (erreur)");
+  printf("  succès = %ld, échecs = %ld  (attendu : 1, 1)\n\n", stats.hits, stats.misses);
+
+  /* Autre dt : autre clé */
+  PfaConfig cfg2;
+  init_integration_r(&cfg2, "gauss3", 20.0);
+  clientCDF_X1X2_r(&client1, 1000.0, &cfg2);
+  /* 5 seuils pour une capacité 4 : le moins récemment utilisé est retiré */
+  double seuils[4] = {200.0, 400.0, 600.0, 800.0};
+  for (int i = 0; i < 4; i++)
+  {
+    clientCDF_X1X2_r(&client1, seuils[i], &cfg);
+  }
+  cache_stats(&stats);
+  printf("  après 6 valeurs différentes : taille = %d, retraits = %ld  (attendu : 4, 2)\n", stats.size, stats.evictions);
+  clientCDF_X1X2_r(&client1, 800.0, &cfg);
+  clientCDF_X1X2_r(&client1, 1000.0, &cfg);
+  cache_stats(&stats);
+  printf("  FX1+X2(800) puis FX1+X2(1000) : succès = %ld, échecs = %ld  (attendu : 2, 7, FX1+X2(1000) a été retiré)\n", stats.hits, stats.misses);
+
+  clear_cache();
+  cache_stats(&stats);
+  printf("  après clear_cache : taille = %d, succès = %ld  (attendu : 0, 0)\n", stats.size, stats.hits);
+  init_cache(0);
+}
+
+/* ====================================================
+   TEST 13 : quantiles de S (VaR)
+   ==================================================== */
+void test_quantiles(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 13 : quantiles de S — clientQuantile_S                  ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 10.0);
+  double probs[3] = {0.7, 0.25, 0.05};
+  InsuredClient client = {7.0, 1.5, probs};
+
+  double alphas[6] = {0.95, 0.5, 0.8, 0.9, 0.7, 1.0};
+  double q[6];
+  clientQuantile_S_batch_r(&client, alphas, 6, q, &cfg);
+
+  printf("  %-8s  %-20s  %-20s  %-12s\n", "alpha", "quantile", "FS(quantile)", "écart");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  for (int j = 0; j < 6; j++)
+  {
+    if (q[j] > 0 && isfinite(q[j]))
+    {
+      double F = clientCDF_S_r(&client, q[j], &cfg);
+      printf("  %-8.3f  %-20.10f  %-20.15f  %.2e\n", alphas[j], q[j], F, fabs(F - alphas[j]));
+    }
+    else
+    {
+      printf("  %-8.3f  %-20.10f\n", alphas[j], q[j]);
+    }
+  }
+  printf("  (attendu : quantile 0 pour alpha <= p[0] = 0.7, inf pour alpha = 1,\n");
+  printf("   écart de l'ordre de l'erreur d'intégration sinon)\n\n");
+
+  double q95 = clientQuantile_S_r(&client, 0.95, &cfg);
+  printf("  clientQuantile_S_r(0.95) = %.10f  (lot : %.10f, écart relatif %.2e)\n",
+         q95, q[0], fabs(q95 - q[0])/q[0]);
+  printf("  clientQuantile_S_r(1.5)  = %f  (attendu : nan)\n", clientQuantile_S_r(&client, 1.5, &cfg));
+}
+
+/* ====================================================
+   TEST 14 : loi du total d'un portefeuille de clients
+   ==================================================== */
+void test_portefeuille(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 14 : total d'un portefeuille (produit de transformées)  ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  /* Un seul client : p0 + p1 X + p2 (X1+X2) sur la même grille */
+  double probs[3] = {0.7, 0.25, 0.05};
+  InsuredClient client = {7.0, 1.5, probs};
+  DiscreteDist* d1 = portfolioDist(&client, 1, 4.0, 5000, 1);
+  DiscreteDist* dX = clientDist_X(&client, 4.0, 5000);
+  DiscreteDist* dX1X2 = clientDist_X1X2(&client, 4.0, 5000);
+  double attendu = 0.7 + 0.25*discreteCDF(dX, 5000.0) + 0.05*discreteCDF(dX1X2, 5000.0);
+  printf("  1 client : FS(5000) = %.10f  (mélange des lois : %.10f, écart %.1e)\n",
+         discreteCDF(d1, 5000.0), attendu, fabs(discreteCDF(d1, 5000.0) - attendu));
+  printf("             FS(5000) par intégration : 0.94332162\n\n");
+  freeDiscreteDist(d1);
+  freeDiscreteDist(dX);
+  freeDiscreteDist(dX1X2);
+
+  /* 100000 clients répartis en 5 classes de tarif */
+  int nb = 100000;
+  double h = 20.0;
+  double classes[5][3] = {{0.7, 0.25, 0.05}, {0.8, 0.15, 0.05}, {0.6, 0.3, 0.1}, {0.9, 0.09, 0.01}, {0.5, 0.4, 0.1}};
+  double sigmas[5] = {0.5, 0.4, 0.6, 0.5, 0.3};
+  /* Moyenne de X discrétisée sur la grille : la convolution conserve les moyennes */
+  double moyennesX[5];
+  for (int c = 0; c < 5; c++)
+  {
+    InsuredClient classe = {3.0, sigmas[c], classes[c]};
+    DiscreteDist* d = clientDist_X(&classe, h, 1000);
+    moyennesX[c] = 0.0;
+    for (int i = 0; i < d->n; i++)
+    {
+      moyennesX[c] += d->mass[i] * i * h;
+    }
+    freeDiscreteDist(d);
+  }
+  InsuredClient* clients = malloc(nb * sizeof(InsuredClient));
+  double moyenne = 0.0, variance = 0.0;
+  for (int i = 0; i < nb; i++)
+  {
+    int c = (i * 7) % 5;
+    clients[i].m = 3.0;
+    clients[i].s = sigmas[c];
+    clients[i].p = classes[c];
+    double EX = exp(3.0 + sigmas[c]*sigmas[c]/2), EX2 = exp(6.0 + 2*sigmas[c]*sigmas[c]);
+    double ES = (classes[c][1] + 2*classes[c][2])*EX;
+    double ES2 = classes[c][1]*EX2 + classes[c][2]*(2*EX2 + 2*EX*EX);
+    moyenne += (classes[c][1] + 2*classes[c][2])*moyennesX[c];
+    variance += ES2 - ES*ES;
+  }
+  DiscreteDist* d4 = portfolioDist(clients, nb, h, 45000, 4);
+  DiscreteDist* d2 = portfolioDist(clients, nb, h, 45000, 2);
+  double m4 = 0.0, total = 0.0;
+  for (int i = 0; i < d4->n; i++)
+  {
+    m4 += d4->mass[i] * i * h;
+    total += d4->mass[i];
+  }
+  printf("  %d clients : masse totale = %.12f  (attendu : 1)\n", nb, total);
+  printf("  moyenne = %.4f  (exacte sur la grille : %.4f)\n", m4, moyenne);
+  double q = discreteQuantile(d4, 0.995);
+  printf("  quantile 99.5%% = %.2f  (loi normale : %.2f)\n", q, moyenne + 2.5758293035489*sqrt(variance));
+  printf("  FS(quantile)    = %.12f  (attendu : 0.995)\n", discreteCDF(d4, q));
+  printf("  2 ou 4 tâches : écart des CDF au quantile = %.1e\n", fabs(discreteCDF(d4, q) - discreteCDF(d2, q)));
+  freeDiscreteDist(d4);
+  freeDiscreteDist(d2);
+
+  /* Grille trop grande pour la transformée (4n > 2^30) : refusée */
+  DiscreteDist* dTrop = portfolioDist(clients, nb, h, 1 << 29, 4);
+  printf("  portfolioDist(n = 2^29) = %s  (attendu : NULL)\n", (dTrop == NULL) ? "NULL" : "non NULL");
+  assert(dTrop == NULL);
+  free(clients);
+}
+
+/* ====================================================
+   TEST 15 : Monte Carlo (Philox4x32-10)
+   ==================================================== */
+void test_monte_carlo(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 15 : Monte Carlo — générateur Philox4x32-10             ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  /* Vecteurs de référence de Random123 */
+  uint32_t compteur1[4] = {0, 0, 0, 0}, cle1[2] = {0, 0};
+  uint32_t compteur2[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, cle2[2] = {0xffffffff, 0xffffffff};
+  uint32_t r[4];
+  philox4x32(compteur1, cle1, r);
+  printf("  philox(0, 0)   = %08x %08x %08x %08x\n", r[0], r[1], r[2], r[3]);
+  printf("  attendu        = 6627e8d5 e169c58d bc57ac4c 9b00dbd8\n");
+  philox4x32(compteur2, cle2, r);
+  printf("  philox(-1, -1) = %08x %08x %08x %08x\n", r[0], r[1], r[2], r[3]);
+  printf("  attendu        = 408f276d 41c83b0e a20bc7c6 6d5451fd\n\n");
+
+  init_phi("erfc");
+  Option opt = { CALL, 100.0, 100.0, 1.0, 0.10, 0.3 };
+  double exact = optionPrice(&opt);
+  McConfig mc;
+  initMcConfig(&mc, 1000000, 2026);
+  McResult res;
+  printf("  Call S0=100, K=100, T=1, mu=0.10, sig=0.3 : prix exact %.6f\n", exact);
+  printf("  %-28s  %-12s  %-12s  %-10s\n", "méthode", "estimation", "erreur std", "|écart|/err");
+  printf("  %s\n", "-------------------------------------------------------------------");
+  char* noms[4] = {"simple", "antithétique", "variable de contrôle", "les deux"};
+  for (int v = 0; v < 4; v++)
+  {
+    mc.antithetic = (v == 1 || v == 3);
+    mc.controlVariate = (v >= 2);
+    mcOptionPrice(&opt, &mc, &res);
+    printf("  %-28s  %-12.6f  %-12.2e  %.2f\n", noms[v], res.value, res.stdError, fabs(res.value - exact)/res.stdError);
+  }
+  printf("  (attendu : |écart|/err < 3, erreur std décroissante)\n\n");
+
+  /* Reproductibilité : les blocs ont leurs propres flux, quel que soit le nombre de threads */
+  McResult res4;
+  mc.threads = 1;
+  mcOptionPrice(&opt, &mc, &res);
+  mc.threads = 4;
+  mcOptionPrice(&opt, &mc, &res4);
+  printf("  1 thread : %.15f   4 threads : %.15f   identiques : %s\n\n", res.value, res4.value,
+         (res.value == res4.value) ? "OUI (correct)" : "NON (erreur)");
+
+  /* Loi de S : comparaison avec clientCDF_S (test 5, dt=5.0) */
+  double probs[3] = {0.7, 0.25, 0.05};
+  InsuredClient client = {7.0, 1.5, probs};
+  mcClientCDF_S(&client, 5000.0, &mc, &res);
+  printf("  FS(5000) Monte Carlo = %.6f +- %.1e  (intégration : 0.94332162, |écart|/err = %.2f)\n",
+         res.value, res.stdError, fabs(res.value - 0.94332162)/res.stdError);
+  init_integration("gauss3", 5.0);
+}
+
+/* ====================================================
+   TEST 16 : Greeks analytiques
+   Comparaison avec des différences finies centrées.
+   ==================================================== */
+void test_greeks(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 16 : Greeks (delta, gamma, vega, theta)                 ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  init_phi("erfc");
+  Option options[2] = {{ CALL, 100.0, 95.0, 0.5, 0.10, 0.3 }, { PUT, 100.0, 95.0, 0.5, 0.10, 0.3 }};
+  for (int k = 0; k < 2; k++)
+  {
+    Option opt = options[k];
+    OptionGreeks g;
+    optionPriceAndGreeks(&opt, &g);
+    double h = 1e-3;
+    Option o1 = opt, o2 = opt;
+    o1.S0 += h; o2.S0 -= h;
+    double p1 = optionPrice(&o1), p2 = optionPrice(&o2), p0 = optionPrice(&opt);
+    double delta = (p1 - p2)/(2*h), gamma = (p1 - 2*p0 + p2)/(h*h);
+    o1 = opt; o2 = opt;
+    o1.sig += h; o2.sig -= h;
+    double vega = (optionPrice(&o1) - optionPrice(&o2))/(2*h);
+    o1 = opt; o2 = opt;
+    o1.T += h; o2.T -= h;
+    double theta = -(optionPrice(&o1) - optionPrice(&o2))/(2*h);
+    printf("  %s S0=100, K=95, T=0.5, mu=0.10, sig=0.3\n", (opt.type == CALL) ? "Call" : "Put");
+    printf("  %-8s  %-16s  %-16s  %-10s\n", "", "analytique", "diff. finies", "écart");
+    printf("  %-8s  %-16.10f  %-16.10f  %.1e\n", "prix", g.price, p0, fabs(g.price - p0));
+    printf("  %-8s  %-16.10f  %-16.10f  %.1e\n", "delta", g.delta, delta, fabs(g.delta - delta));
+    printf("  %-8s  %-16.10f  %-16.10f  %.1e\n", "gamma", g.gamma, gamma, fabs(g.gamma - gamma));
+    printf("  %-8s  %-16.10f  %-16.10f  %.1e\n", "vega", g.vega, vega, fabs(g.vega - vega));
+    printf("  %-8s  %-16.10f  %-16.10f  %.1e\n\n", "theta", g.theta, theta, fabs(g.theta - theta));
+  }
+  printf("  (attendu : écarts < 1e-4, erreur en h² des différences finies, h = 1e-3)\n\n");
+
+  /* Version par lots : même résultat que la version scalaire (méthode "table") */
+  init_phi("table");
+  int n = 1000;
+  unsigned long long etat = 7;
+  OptionType* type = malloc(n * sizeof(OptionType));
+  double* v = malloc(11 * n * sizeof(double));
+  OptionBatch lot = {n, type, v, v + n, v + 2*n, v + 3*n, v + 4*n};
+  OptionGreeksBatch res = {v + 5*n, v + 6*n, v + 7*n, v + 8*n, v + 9*n};
+  for (int i = 0; i < n; i++)
+  {
+    type[i] = (i % 2 == 0) ? CALL : PUT;
+    lot.S0[i] = 50.0 + 100.0*aleatoire(&etat);
+    lot.K[i] = 50.0 + 100.0*aleatoire(&etat);
+    lot.T[i] = 0.1 + 2.0*aleatoire(&etat);
+    lot.mu[i] = -0.05 + 0.15*aleatoire(&etat);
+    lot.sig[i] = 0.05 + 0.5*aleatoire(&etat);
+  }
+  optionPriceAndGreeksBatch(&lot, &res);
+  double ecart = 0.0;
+  for (int i = 0; i < n; i++)
+  {
+    Option opt = {type[i], lot.S0[i], lot.K[i], lot.T[i], lot.mu[i], lot.sig[i]};
+    OptionGreeks g;
+    optionPriceAndGreeks(&opt, &g);
+    double d[5] = {g.price - res.price[i], g.delta - res.delta[i], g.gamma - res.gamma[i],
+                   g.vega - res.vega[i], g.theta - res.theta[i]};
+    double echelle[5] = {opt.S0 + opt.K, 1.0 + exp(opt.mu*opt.T), 1.0, opt.S0 + opt.K, opt.S0 + opt.K};
+    for (int j = 0; j < 5; j++)
+    {
+      double e = fabs(d[j])/echelle[j];
+      ecart = (e > ecart) ? e : ecart;
+    }
+  }
+  printf("  %d options par lots : écart relatif maximal avec la version scalaire = %.1e  (attendu : < 1e-11)\n", n, ecart);
+  free(type);
+  free(v);
+  init_phi("quadrature");
+}
+
+/* ====================================================
+   TEST 17 : volatilités implicites par lots
+   ==================================================== */
+void test_vol_implicite(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 17 : volatilités implicites (impliedVolBatch)           ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  /* Aller-retour : prix calculés avec sig connu, puis inversés */
+  int n = 100000;
+  unsigned long long etat = 11;
+  OptionType* type = malloc(n * sizeof(OptionType));
+  double* v = malloc(8 * n * sizeof(double));
+  OptionBatch lot = {n, type, v, v + n, v + 2*n, v + 3*n, v + 4*n};
+  double* prix = v + 5*n;
+  double* sigma = v + 6*n;
+  ImpliedVolStatus* statut = malloc(n * sizeof(ImpliedVolStatus));
+  for (int i = 0; i < n; i++)
+  {
+    type[i] = (i % 2 == 0) ? CALL : PUT;
+    lot.S0[i] = 100.0;
+    lot.K[i] = 60.0 + 80.0*aleatoire(&etat);
+    lot.T[i] = 0.1 + 2.0*aleatoire(&etat);
+    lot.mu[i] = 0.05*aleatoire(&etat);
+    lot.sig[i] = 0.1 + 0.5*aleatoire(&etat);
+    sigma[i] = lot.sig[i];
+  }
+  optionPriceBatch(&lot, prix);
+  clock_t debut = clock();
+  int echecs = impliedVolBatch(&lot, prix, statut);
+  double duree = (double) (clock() - debut) / CLOCKS_PER_SEC;
+  double ecart = 0.0;
+  int echecsVega = 0;
+  for (int i = 0; i < n; i++)
+  {
+    /* Prix presque égal à la valeur intrinsèque (vega ~ 0) : sig n'est pas déterminé par
+       le prix arrondi, et l'arrondi peut même le rendre inférieur à la valeur intrinsèque */
+    Option opt = {type[i], lot.S0[i], lot.K[i], lot.T[i], lot.mu[i], sigma[i]};
+    OptionGreeks g;
+    optionPriceAndGreeks(&opt, &g);
+    if (g.vega > 1e-3)
+    {
+      echecsVega += (statut[i] != IV_OK);
+      ecart = (statut[i] == IV_OK) ? fmax(ecart, fabs(lot.sig[i] - sigma[i])) : ecart;
+    }
+  }
+  printf("  %d options : échecs = %d, dont %d avec vega > 1e-3  (attendu : 0)\n", n, echecs, echecsVega);
+  printf("  écart maximal |sig trouvé - sig| (vega > 1e-3) = %.1e  (attendu : < 1e-8)\n", ecart);
+  printf("  durée : %.3f s\n\n", duree);
+
+  /* Prix impossibles */
+  OptionType types[5] = {CALL, CALL, PUT, PUT, CALL};
+  double S0s[5] = {100.0, 100.0, 100.0, 100.0, 100.0};
+  double Ks[5] = {90.0, 90.0, 110.0, 110.0, 90.0};
+  double Ts[5] = {1.0, 1.0, 1.0, 1.0, 0.0};
+  double mus[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+  double sigs[5];
+  double prix2[5] = {5.0, 100.0, 9.0, 110.0, 12.0};
+  OptionBatch lot2 = {5, types, S0s, Ks, Ts, mus, sigs};
+  ImpliedVolStatus statut2[5];
+  impliedVolBatch(&lot2, prix2, statut2);
+  char* attendus[5] = {"IV_BELOW_INTRINSIC", "IV_ABOVE_MAX", "IV_BELOW_INTRINSIC", "IV_ABOVE_MAX", "IV_INVALID"};
+  char* noms[5] = {"IV_OK", "IV_BELOW_INTRINSIC", "IV_ABOVE_MAX", "IV_NO_CONVERGENCE", "IV_INVALID"};
+  for (int i = 0; i < 5; i++)
+  {
+    printf("  %s K=%.0f T=%.0f prix=%6.2f : %-20s (attendu : %s)\n", (types[i] == CALL) ? "call" : "put ",
+           Ks[i], Ts[i], prix2[i], noms[statut2[i]], attendus[i]);
+  }
+  free(type);
+  free(v);
+  free(statut);
+}
+
+/* ====================================================
+   TEST 18 : instrumentation (compilée avec -DPFA_INSTRUMENT)
+   ==================================================== */
+void test_instrumentation(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 18 : compteurs d'instrumentation                        ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  if (!instrEnabled())
+  {
+    printf("  Instrumentation désactivée (compiler avec -DPFA_INSTRUMENT)\n");
+    return;
+  }
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 50.0);
+  double probs[3] = {0.7, 0.25, 0.05};
+  InsuredClient client = {7.0, 1.5, probs};
+  instrReset();
+  clientCDF_X1X2_r(&client, 1000.0, &cfg);
+  InstrCounters c;
+  instrThreadCounters(&c);
+  /* 20 subdivisions extérieures, puis une intégrale intérieure par noeud */
+  printf("  FX1+X2(1000), gauss3, dt=50 :\n");
+  printf("  intégrations = %ld  (attendu : 1 + 60 = 61)\n", c.integrations);
+  printf("  profondeur   = %d  (attendu : 2)\n", c.maxDepth);
+  printf("  évaluations  = %ld, subdivisions = %ld, phi = %ld\n", c.integrandCalls, c.subintervals, c.phiCalls);
+}
+
+/* ====================================================
+   TEST 19 : carnet de clients en colonnes (mmap)
+   ==================================================== */
+void test_carnet_clients(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 19 : carnet de clients en colonnes (mmap)               ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  long n = 100000;
+  InsuredClient* clients = malloc(n * sizeof(InsuredClient));
+  double* probs = malloc(3 * n * sizeof(double));
+  unsigned long long etat = 2026;
+  for (long i = 0; i < n; i++)
+  {
+    double p1 = 0.3 * aleatoire(&etat);
+    double p2 = 0.1 * aleatoire(&etat);
+    probs[3*i] = 1.0 - p1 - p2;
+    probs[3*i+1] = p1;
+    probs[3*i+2] = p2;
+    clients[i].m = 5.0 + 3.0 * aleatoire(&etat);
+    clients[i].s = 0.5 + 1.5 * aleatoire(&etat);
+    clients[i].p = &probs[3*i];
+  }
+  char* fichier = "test_carnet.book";
+  clock_t debut = clock();
+  bool ecrit = writeClientBook(fichier, clients, n);
+  double tEcriture = (double) (clock() - debut) / CLOCKS_PER_SEC;
+  debut = clock();
+  ClientBook* carnet = openClientBook(fichier, false);
+  double tOuverture = (double) (clock() - debut) / CLOCKS_PER_SEC;
+  printf("  %ld clients : écriture %s en %.3f s, ouverture sans vérification en %.6f s\n",
+         n, ecrit ? "réussie" : "ÉCHOUÉE", tEcriture, tOuverture);
+  /* Écriture impossible (périphérique plein) : échec, fichier toujours fermé */
+  bool plein = writeClientBook("/dev/full", clients, n);
+  printf("  écriture sur /dev/full : %s  (attendu : ÉCHOUÉE)\n", plein ? "réussie" : "ÉCHOUÉE");
+  assert(!plein);
+  if (carnet == NULL)
+  {
+    printf("  ERREUR : le carnet n'a pas pu être ouvert\n");
+    free(clients);
+    free(probs);
+    return;
+  }
+
+  long differences = 0;
+  for (long i = 0; i < n; i++)
+  {
+    InsuredClient vue;
+    bookClient(carnet, i, &vue);
+    if (vue.m != clients[i].m || vue.s != clients[i].s || vue.p[0] != probs[3*i]
+        || vue.p[1] != probs[3*i+1] || vue.p[2] != probs[3*i+2])
+    {
+      differences++;
+    }
+  }
+  printf("  clients relus différents : %ld  (attendu : 0)\n", differences);
+
+  InsuredClient* vues = bookClients(carnet);
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 0.1);
+  double ecartMax = 0.0;
+  for (long i = 0; i < n; i += n/5)
+  {
+    double attendu = clientCDF_X_r(&clients[i], 2000.0, &cfg);
+    double obtenu = clientCDF_X_r(&vues[i], 2000.0, &cfg);
+    ecartMax = fmax(ecartMax, fabs(obtenu - attendu));
+  }
+  printf("  FX(2000) vue / client d'origine, écart max = %.1e  (attendu : 0)\n", ecartMax);
+  free(vues);
+  closeClientBook(carnet);
+
+  debut = clock();
+  carnet = openClientBook(fichier, true);
+  printf("  ouverture avec vérification de la somme de contrôle : %s en %.3f s\n",
+         (carnet != NULL) ? "réussie" : "ÉCHOUÉE", (double) (clock() - debut) / CLOCKS_PER_SEC);
+  closeClientBook(carnet);
+
+  /* Un octet modifié dans la colonne s */
+  FILE* f = fopen(fichier, "r+b");
+  fseek(f, CLIENTBOOK_HEADER + n * sizeof(double) + 100, SEEK_SET);
+  fputc(0x5a, f);
+  fclose(f);
+  carnet = openClientBook(fichier, true);
+  printf("  carnet modifié, avec vérification : %s  (attendu : refusé)\n", (carnet == NULL) ? "refusé" : "accepté");
+  closeClientBook(carnet);
+  carnet = openClientBook(fichier, false);
+  printf("  carnet modifié, sans vérification : %s  (attendu : accepté)\n", (carnet == NULL) ? "refusé" : "accepté");
+  closeClientBook(carnet);
+
+  /* Fichier tronqué */
+  truncate(fichier, CLIENTBOOK_HEADER + n * sizeof(double));
+  carnet = openClientBook(fichier, false);
+  printf("  carnet tronqué : %s  (attendu : refusé)\n", (carnet == NULL) ? "refusé" : "accepté");
+  closeClientBook(carnet);
+  remove(fichier);
+  free(clients);
+  free(probs);
+}
+
+/* ====================================================
+   TEST 20 : grille partagée de la densité de X
+   ==================================================== */
+void test_grille_severite(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 20 : grille partagée de fX pour FX1+X2                  ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  double probs[3] = {0.7, 0.25, 0.05};
+  InsuredClient client = {7.0, 1.5, probs};
+  PfaConfig ref;
+  init_integration_r(&ref, "adaptive", 1e-12);
+  double x = 1000.0;
+  double exact = clientCDF_X1X2_r(&client, x, &ref);
+  char* formules[] = {"gauss3", "simpson", "trapezes"};
+  double pas[] = {5.0, 2.0};
+
+  printf("  FX1+X2(1000), référence adaptive 1e-12 = %.12f\n\n", exact);
+  printf("  %-10s  %-5s  %-12s  %-12s  %-10s  %-10s\n", "formule", "dt", "erreur", "erreur grille", "temps (s)", "grille (s)");
+  printf("  %s\n", "-------------------------------------------------------------------------");
+  for (int f = 0; f < 3; f++)
+  {
+    for (int d = 0; d < 2; d++)
+    {
+      PfaConfig cfg, grille;
+      init_integration_r(&cfg, formules[f], pas[d]);
+      init_integration_r(&grille, formules[f], pas[d]);
+      init_severity_grid_r(&grille, true);
+      clock_t debut = clock();
+      double v = clientCDF_X1X2_r(&client, x, &cfg);
+      double t = (double) (clock() - debut) / CLOCKS_PER_SEC;
+      debut = clock();
+      double vg = clientCDF_X1X2_r(&client, x, &grille);
+      double tg = (double) (clock() - debut) / CLOCKS_PER_SEC;
+      printf("  %-10s  %-5.1f  %-12.2e  %-12.2e   %-10.4f  %-10.4f\n", formules[f], pas[d],
+             fabs(v - exact), fabs(vg - exact), t, tg);
+    }
+  }
+  printf("\n  (attendu : erreurs du même ordre avec et sans grille, grille >= 10x plus rapide)\n");
+
+  /* gauss16 : 32 subdivisions par paquet de derniers points, 200 subdivisions */
+  PfaConfig g16, g16grille;
+  init_integration_r(&g16, "gauss16", 5.0);
+  init_integration_r(&g16grille, "gauss16", 5.0);
+  init_severity_grid_r(&g16grille, true);
+  double v16 = clientCDF_X1X2_r(&client, x, &g16);
+  double vg16 = clientCDF_X1X2_r(&client, x, &g16grille);
+  printf("  gauss16 dt=5 : sans grille %.12f, grille %.12f  (attendu : écart < 1e-9)\n", v16, vg16);
+  assert(fabs(v16 - vg16) < 1e-9);
+
+  PfaConfig cfg;
+  init_integration_r(&cfg, "gauss3", 5.0);
+  init_severity_grid_r(&cfg, true);
+  printf("  FS(1000) avec grille, gauss3 dt=5 : %.10f  (attendu : %.10f)\n",
+         clientCDF_S_r(&client, x, &cfg), clientCDF_S_r(&client, x, &ref));
+}
+
+/* ====================================================
+   TEST 21 : chemin rapide en simple précision
+   ==================================================== */
+void test_simple_precision(void)
+{
+  printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+  printf("║  TEST 21 : simple précision (vecExpf, optionPriceBatchf)      ║\n");
+  printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+  /* Précision des fonctions vectorielles float par rapport au double */
+  char* jeux[] = {"scalar", "avx2", "avx512"};
+  printf("  %-8s  %-14s  %-14s  %-14s\n", "jeu", "expf (err rel)", "logf (err rel)", "PHIf (err abs)");
+  printf("  %s\n", "----------------------------------------------------------");
+  for (int j = 0; j < 3; j++)
+  {
+    if (!setVecISA(jeux[j]))
+    {
+      printf("  %-8s  non disponible sur ce processeur\n", jeux[j]);
+      continue;
+    }
+    float x[2000], y[2000];
+    double err_exp = 0.0, err_log = 0.0, err_PHI = 0.0;
+    for (int i = 0; i < 2000; i++) x[i] = -87.0f + 0.0875f * i;
+    vecExpf(x, y, 2000);
+    for (int i = 0; i < 2000; i++)
+    {
+      double e = fabs(y[i] - exp(x[i])) / exp(x[i]);
+      if (e > err_exp) err_exp = e;
+    }
+    for (int i = 0; i < 2000; i++) x[i] = 1e-30f * powf(10.0f, 0.03f * i);
+    vecLogf(x, y, 2000);
+    for (int i = 0; i < 2000; i++)
+    {
+      double e = fabs(y[i] - log(x[i])) / fmax(fabs(log(x[i])), 1.0);
+      if (e > err_log) err_log = e;
+    }
+    for (int i = 0; i < 2000; i++) x[i] = -10.0f + 0.01f * i;
+    vecPHIf(x, y, 2000);
+    for (int i = 0; i < 2000; i++)
+    {
+      double e = fabs(y[i] - 0.5 * erfc(-x[i] / sqrt(2.0)));
+      if (e > err_PHI) err_PHI = e;
+    }
+    printf("  %-8s  %-14.2e  %-14.2e  %-14.2e\n", jeux[j], err_exp, err_log, err_PHI);
+  }
+  setVecISA("auto");
+  printf("  (attendu : < 2e-7 pour les trois)\n\n");
+
+  /* Lot d'options : float comparé au double sur les mêmes entrées */
+  int n = 200000;
+  OptionType* type = malloc(n * sizeof(OptionType));
+  float* Sf = malloc(6 * n * sizeof(float));
+  float *Kf = Sf + n, *Tf = Sf + 2*n, *muf = Sf + 3*n, *sigf = Sf + 4*n, *prixf = Sf + 5*n;
+  float* erreur = malloc(n * sizeof(float));
+  double* Sd = malloc(6 * n * sizeof(double));
+  double *Kd = Sd + n, *Td = Sd + 2*n, *mud = Sd + 3*n, *sigd = Sd + 4*n, *prixd = Sd + 5*n;
+  unsigned long long etat = 2026;
+  for (int i = 0; i < n; i++)
+  {
+    type[i] = (i % 3 == 0) ? PUT : CALL;
+    Sf[i]   = (float) (50.0 + 100.0 * aleatoire(&etat));
+    Kf[i]   = (float) (50.0 + 100.0 * aleatoire(&etat));
+    Tf[i]   = (float) (0.02 + 3.0 * aleatoire(&etat));
+    muf[i]  = (float) (-0.05 + 0.15 * aleatoire(&etat));
+    sigf[i] = (float) (0.02 + 0.6 * aleatoire(&etat));
+    Sd[i] = Sf[i]; Kd[i] = Kf[i]; Td[i] = Tf[i]; mud[i] = muf[i]; sigd[i] = sigf[i];
+  }
+  OptionBatchf lotf = { n, type, Sf, Kf, Tf, muf, sigf };
+  OptionBatch lotd = { n, type, Sd, Kd, Td, mud, sigd };
+
+  /* Les temps (programme de test compilé sans optimisation) sont mesurés par bench.c */
+  optionPriceBatch(&lotd, prixd);
+  optionPriceBatchf(&lotf, prixf, erreur);
+
+  double derive_max = 0.0, estimation_max = 0.0;
+  int depassements = 0;
+  for (int i = 0; i < n; i++)
+  {
+    double ecart = fabs(prixf[i] - prixd[i]);
+    double FK = Sd[i] * exp(mud[i] * Td[i]) + Kd[i];
+    if (ecart / FK > derive_max) derive_max = ecart / FK;
+    if (erreur[i] / FK > estimation_max) estimation_max = erreur[i] / FK;
+    if (ecart > erreur[i]) depassements++;
+  }
+  printf("  %d options, float comparé au double sur les mêmes entrées\n", n);
+  printf("  écart max / (F+K) : %.2e   estimation max / (F+K) : %.2e\n", derive_max, estimation_max);
+  printf("  options dont l'écart dépasse l'estimation : %d  (attendu : 0)\n", depassements);
+
+  /* Contrôle par échantillonnage */
+  PriceCheckf controle = { 64, 1e-5, 0, 0, 0.0, -1 };
+  bool ok = checkPriceBatchf(&lotf, prixf, &controle);
+  printf("\n  contrôle 1/64, seuil 1e-5 : %s, %ld options, dérive max %.2e  (attendu : ok, %d options)\n",
+         ok ? "ok" : "ALERTE", controle.checked, controle.maxDrift, (n - 32 + 63) / 64);
+  int faux = 32 + 64 * 100;
+  prixf[faux] += 0.01f * Kf[faux];
+  ok = checkPriceBatchf(&lotf, prixf, &controle);
+  printf("  prix %d faussé de 1%% de K : %s, %ld alerte(s), première %d  (attendu : ALERTE, 1, %d)\n",
+         faux, ok ? "ok" : "ALERTE", controle.alerts, controle.firstAlert, faux);
+  prixf[faux] -= 0.01f * Kf[faux];
+  int degenere = 32 + 64 * 200;
+  Tf[degenere] = 0.0f;
+  Kf[degenere] = Sf[degenere];
+  optionPriceBatchf(&lotf, prixf, NULL);
+  ok = checkPriceBatchf(&lotf, prixf, &controle);
+  printf("  option %d avec T=0 à la monnaie (prix nan) : %s, première %d  (attendu : ALERTE, %d)\n",
+         degenere, ok ? "ok" : "ALERTE", controle.firstAlert, degenere);
+  assert(!ok && controle.firstAlert == degenere);
+
+  /* phi_batchf comparée à phi */
+  float xs[1000], ys[1000];
+  double err_phi = 0.0;
+  for (int i = 0; i < 1000; i++) xs[i] = -8.0f + 0.016f * i;
+  phi_batchf(xs, ys, 1000);
+  for (int i = 0; i < 1000; i++)
+  {
+    double e = fabs(ys[i] - phi(xs[i])) / phi(xs[i]) / (2.0 + xs[i] * xs[i]);
+    if (e > err_phi) err_phi = e;
+  }
+  printf("  phi_batchf : erreur relative max / (2 + x²) %.2e  (borne 1.2e-7)\n", err_phi);
+
+  free(type);
+  free(Sf);
+  free(erreur);
+  free(Sd);
+}
+
 /* ====================================================
    main
    ==================================================== */
@@ -385,6 +1511,22 @@ int main(void)
   printf("\n  [Tests 4 et 5 : double intégration, dt=5.0 — quelques secondes...]\n");
   test_loi_X1X2();
   test_loi_S();
+  test_reentrant();
+  test_methodes_PHI();
+  test_convolution_fft();
+  test_courbes();
+  test_lot_options();
+  test_adaptatif();
+  test_cache();
+  test_quantiles();
+  test_portefeuille();
+  test_monte_carlo();
+  test_greeks();
+  test_vol_implicite();
+  test_instrumentation();
+  test_carnet_clients();
+  test_grille_severite();
+  test_simple_precision();
 
   printf("\n╔══════════════════════════════════════════════════════════════╗\n");
   printf("║  TOUS LES TESTS TERMINÉS                                      ║\n");
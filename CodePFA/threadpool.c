@@ -0,0 +1,149 @@
+#define THREADPOOL_C
+
+#include <pthread.h>
+#include <unistd.h>
+#include "threadpool.h"
+
+struct ThreadPool{
+  pthread_mutex_t lock;
+  pthread_cond_t start;   /* Signaled when a new job is available */
+  pthread_cond_t done;    /* Signaled when a task of the job is finished */
+  int nworkers;
+  unsigned long job;      /* Number of the current job (incremented for each job) */
+  bool busy;              /* A job is running */
+
+  /* Current job */
+  void (*task)(int, void*);
+  void* data;
+  int ntasks;
+  int next;               /* Next task to execute */
+  int finished;           /* Number of tasks finished */
+  int joined;             /* Number of workers which joined the job */
+  int maxJoined;          /* Maximal number of workers for the job */
+};
+
+static ThreadPool* sharedPool = NULL;
+static pthread_mutex_t sharedPoolLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread bool inTask = false;
+
+bool inParallelTask(void)
+{
+  return inTask;
+}
+
+int nbProcessors(void)
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n < 1) ? 1 : (int) n;
+}
+
+/* Executes tasks of the current job until there is none left. pool->lock is held on entry and on exit. */
+static void runTasks(ThreadPool* pool)
+{
+  while (pool->next < pool->ntasks)
+  {
+    int i = pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+    inTask = true;
+    pool->task(i, pool->data);
+    inTask = false;
+    pthread_mutex_lock(&pool->lock);
+    pool->finished++;
+    if (pool->finished == pool->ntasks)
+    {
+      pthread_cond_broadcast(&pool->done);
+    }
+  }
+}
+
+static void* worker(void* arg)
+{
+  ThreadPool* pool = (ThreadPool*) arg;
+  unsigned long seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  seen = pool->job;
+  for (;;)
+  {
+    while (pool->job == seen)
+    {
+      pthread_cond_wait(&pool->start, &pool->lock);
+    }
+    seen = pool->job;
+    if (pool->busy && pool->joined < pool->maxJoined)
+    {
+      pool->joined++;
+      runTasks(pool);
+    }
+  }
+  return NULL;
+}
+
+ThreadPool* getThreadPool(int nthreads)
+{
+  pthread_mutex_lock(&sharedPoolLock);
+  if (sharedPool == NULL)
+  {
+    sharedPool = calloc(1, sizeof(ThreadPool));
+    pthread_mutex_init(&sharedPool->lock, NULL);
+    pthread_cond_init(&sharedPool->start, NULL);
+    pthread_cond_init(&sharedPool->done, NULL);
+  }
+  pthread_mutex_lock(&sharedPool->lock);
+  while (sharedPool->nworkers < nthreads-1)
+  {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, worker, sharedPool) != 0)
+    {
+      break;
+    }
+    pthread_detach(thread);
+    sharedPool->nworkers++;
+  }
+  pthread_mutex_unlock(&sharedPool->lock);
+  pthread_mutex_unlock(&sharedPoolLock);
+  return sharedPool;
+}
+
+void parallelFor(ThreadPool* pool, int nthreads, int ntasks, void (*task)(int, void*), void* data)
+{
+  bool serial = (pool == NULL || nthreads <= 1 || ntasks <= 1 || inTask);
+  if (!serial)
+  {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->busy)
+    {
+      serial = true;
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+  if (serial)
+  {
+    bool nested = inTask;
+    inTask = true;
+    for (int i = 0; i < ntasks; i++)
+    {
+      task(i, data);
+    }
+    inTask = nested;
+    return;
+  }
+
+  pool->busy = true;
+  pool->task = task;
+  pool->data = data;
+  pool->ntasks = ntasks;
+  pool->next = 0;
+  pool->finished = 0;
+  pool->joined = 0;
+  pool->maxJoined = nthreads-1;
+  pool->job++;
+  pthread_cond_broadcast(&pool->start);
+
+  runTasks(pool);
+  while (pool->finished < pool->ntasks)
+  {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pool->busy = false;
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,41 @@
+/*************************************/
+/* Header file threadpool.h          */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/* Pool of worker threads, created once and reused by all the parallel computations.
+   A job is a set of ntasks independent tasks task(0, data) ... task(ntasks-1, data).
+   The tasks are distributed dynamically: the result of a job must not depend on which
+   thread executes which task. */
+typedef struct ThreadPool ThreadPool;
+
+#ifdef THREADPOOL_C
+
+#else /* THREADPOOL_C */
+
+/* Returns the pool shared by the library, with at least nthreads-1 workers (the thread
+   which runs a job also executes tasks). The pool is created or enlarged if needed. */
+extern ThreadPool* getThreadPool(int nthreads);
+
+/* Runs task(i, data) for i = 0..ntasks-1 on at most nthreads threads (including the
+   calling thread), and returns when all the tasks are done.
+   If the pool is already running a job, or if it is called from a task (nested
+   parallelism), the tasks are all executed by the calling thread. */
+extern void parallelFor(ThreadPool* pool, int nthreads, int ntasks, void (*task)(int, void*), void* data);
+
+/* Number of processors, used as default number of threads */
+extern int nbProcessors(void);
+
+/* true when called from a task of a job */
+extern bool inParallelTask(void);
+
+#endif /* THREADPOOL_C */
+
+#endif /* THREADPOOL_H */
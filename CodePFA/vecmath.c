@@ -0,0 +1,718 @@
+#define VECMATH_C
+
+#include <pthread.h>
+#include <stdint.h>
+#include <immintrin.h>
+#include "vecmath.h"
+
+/* ==========================================================*/
+/* Table of PHI                                               */
+
+/* On each interval [xi, xi+h] of the table, PHI is replaced by the polynomial of degree 5
+   which has the same values as PHI, phi and phi' at both ends (quintic Hermite interpolation).
+   The error is at most h^6/46080 * max|phi^(5)| = 2.31 * h^6/46080, i.e. 4.7e-14 for h=1/32.
+   Outside [-PHI_TABLE_MAX, PHI_TABLE_MAX], PHI is 0 or 1 up to 1e-17.
+*/
+#define PHI_TABLE_MAX 8.5
+#define PHI_TABLE_STEPS 32 /* Number of intervals per unit: h = 1/32 */
+#define PHI_TABLE_SIZE 544   /* 2*PHI_TABLE_MAX*PHI_TABLE_STEPS */
+
+/* Coefficients c0..c5 of the polynomial on each interval, in the variable t in [0,1] */
+static double phiTable[PHI_TABLE_SIZE][6];
+static pthread_once_t phiTableOnce = PTHREAD_ONCE_INIT;
+
+static double normalDensity(double x)
+{
+  return 0.398942280401433 * exp( -x*x/2 );
+}
+
+static double normalCDF(double x)
+{
+  return 0.5*erfc(-x*0.707106781186547524);
+}
+
+static void buildPhiTable(void)
+{
+  double h = 1.0/PHI_TABLE_STEPS;
+  for (int i = 0; i < PHI_TABLE_SIZE; i++)
+  {
+    double x0 = -PHI_TABLE_MAX + i*h;
+    double x1 = x0 + h;
+    /* Values of PHI, and of its first two derivatives (multiplied by h and h^2) */
+    double f0 = normalCDF(x0), d0 = h*normalDensity(x0), s0 = -h*h*x0*normalDensity(x0);
+    double f1 = normalCDF(x1), d1 = h*normalDensity(x1), s1 = -h*h*x1*normalDensity(x1);
+    phiTable[i][0] = f0;
+    phiTable[i][1] = d0;
+    phiTable[i][2] = s0/2.0;
+    phiTable[i][3] = -10*f0 - 6*d0 - 1.5*s0 + 10*f1 - 4*d1 + 0.5*s1;
+    phiTable[i][4] =  15*f0 + 8*d0 + 1.5*s0 - 15*f1 + 7*d1 -     s1;
+    phiTable[i][5] =  -6*f0 - 3*d0 - 0.5*s0 +  6*f1 - 3*d1 + 0.5*s1;
+  }
+}
+
+void initPhiTable(void)
+{
+  pthread_once(&phiTableOnce, buildPhiTable);
+}
+
+double tablePHI(double x)
+{
+  initPhiTable();
+  if (isnan(x))
+  {
+    return x;
+  }
+  if (!(x > -PHI_TABLE_MAX))
+  {
+    return 0.0;
+  }
+  if (!(x < PHI_TABLE_MAX))
+  {
+    return 1.0;
+  }
+  double u = (x + PHI_TABLE_MAX)*PHI_TABLE_STEPS;
+  int i = (int) u;
+  if (i < 0) i = 0;
+  if (i >= PHI_TABLE_SIZE) i = PHI_TABLE_SIZE-1;
+  double t = u - i;
+  double* c = phiTable[i];
+  return c[0] + t*(c[1] + t*(c[2] + t*(c[3] + t*(c[4] + t*c[5]))));
+}
+
+/* Single precision PHI without table (the gathers of vecPHI cost as much per value in float
+   as in double): erfc(z) = t*(a1 + t*(a2 + ... + t*a5))*exp(-z*z) with t = 1/(1 + p*z),
+   z = |x|/sqrt(2) >= 0 (Abramowitz and Stegun 7.1.26, absolute error < 1.5e-7 on erfc) */
+#define ERFC_P 0.3275911f
+static const float erfcCoeffs[5] = {
+  0.254829592f, -0.284496736f, 1.421413741f, -1.453152027f, 1.061405429f
+};
+
+static float scalarPHIf(float x)
+{
+  float z = fabsf(x)*0.707106781f;
+  float t = 1.0f/(1.0f + ERFC_P*z);
+  float p = erfcCoeffs[4];
+  for (int i = 3; i >= 0; i--)
+  {
+    p = p*t + erfcCoeffs[i];
+  }
+  float half = 0.5f*t*p*expf(-z*z);
+  return (x < 0) ? half : 1.0f - half;
+}
+
+/* ==========================================================*/
+/* Selection of the instruction set                           */
+
+static VecISA vecISA = VEC_SCALAR;
+static pthread_once_t vecISAOnce = PTHREAD_ONCE_INIT;
+
+static bool isaSupported(VecISA isa)
+{
+  switch (isa)
+  {
+    case VEC_AVX512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+    case VEC_AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    default:
+      return true;
+  }
+}
+
+static VecISA bestISA(void)
+{
+  return isaSupported(VEC_AVX512) ? VEC_AVX512 : (isaSupported(VEC_AVX2) ? VEC_AVX2 : VEC_SCALAR);
+}
+
+static void chooseVecISA(void)
+{
+  vecISA = bestISA();
+}
+
+bool setVecISA(char* name)
+{
+  /* The automatic choice is done first, so that it can not replace this one later */
+  pthread_once(&vecISAOnce, chooseVecISA);
+  VecISA isa;
+  if (strcmp(name, "auto") == 0)
+  {
+    isa = bestISA();
+  }
+  else if (strcmp(name, "scalar") == 0)
+  {
+    isa = VEC_SCALAR;
+  }
+  else if (strcmp(name, "avx2") == 0)
+  {
+    isa = VEC_AVX2;
+  }
+  else if (strcmp(name, "avx512") == 0)
+  {
+    isa = VEC_AVX512;
+  }
+  else
+  {
+    return false;
+  }
+  if (!isaSupported(isa))
+  {
+    return false;
+  }
+  vecISA = isa;
+  return true;
+}
+
+VecISA getVecISA(void)
+{
+  pthread_once(&vecISAOnce, chooseVecISA);
+  return vecISA;
+}
+
+char* vecISAName(VecISA isa)
+{
+  switch (isa)
+  {
+    case VEC_AVX512: return "avx512";
+    case VEC_AVX2:   return "avx2";
+    default:         return "scalar";
+  }
+}
+
+/* ==========================================================*/
+/* Polynomials shared by the vector versions                  */
+
+/* exp(x) = 2^k * exp(r), with k = round(x/ln2) and |r| <= ln2/2.
+   exp(r) is its Taylor polynomial of degree 13: error r^14/14! < 1e-18.
+   ln2 is split in a high part (exact product with k) and a low part. */
+#define EXP_LN2_HI 6.93147180369123816490e-01
+#define EXP_LN2_LO 1.90821492927058770002e-10
+#define EXP_MAX 709.0
+#define EXP_MIN -708.0
+static const double expCoeffs[14] = {
+  1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720, 1.0/5040, 1.0/40320, 1.0/362880,
+  1.0/3628800, 1.0/39916800, 1.0/479001600, 1.0/6227020800.0
+};
+
+/* log(x) = e*ln2 + log(m), with m in [sqrt(2)/2, sqrt(2)].
+   log(m) = 2 atanh(f) = 2(f + f^3/3 + f^5/5 + ...), f = (m-1)/(m+1), |f| <= 0.1716:
+   the terms up to f^23 give an error < 1e-18. */
+#define LOG_TERMS 12
+
+/* Single precision: exp(r) of degree 7 (error r^8/8! < 6e-9 for |r| <= ln2/2), ln2 split
+   so that k*LN2F_HI is exact, and log(m) up to f^9 (error < 1e-9) */
+#define LN2F_HI 0.693359375f
+#define LN2F_LO -2.12194440e-4f
+#define EXPF_MAX 88.0f
+#define EXPF_MIN -87.0f
+static const float expfCoeffs[8] = {
+  1.0f, 1.0f, 1.0f/2, 1.0f/6, 1.0f/24, 1.0f/120, 1.0f/720, 1.0f/5040
+};
+#define LOGF_TERMS 5
+
+/* ==========================================================*/
+/* AVX2 versions (4 doubles)                                  */
+
+__attribute__((target("avx2,fma")))
+static inline __m256d exp_avx2(__m256d x)
+{
+  __m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN)), _mm256_set1_pd(EXP_MAX));
+  __m256d k = _mm256_round_pd(_mm256_mul_pd(xc, _mm256_set1_pd(1.4426950408889634)),
+                              _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_HI), xc);
+  r = _mm256_fnmadd_pd(k, _mm256_set1_pd(EXP_LN2_LO), r);
+  __m256d p = _mm256_set1_pd(expCoeffs[13]);
+  for (int i = 12; i >= 0; i--)
+  {
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(expCoeffs[i]));
+  }
+  /* 2^k : k is moved to the low bits of the mantissa with the constant 1.5*2^52 */
+  __m256d magic = _mm256_set1_pd(6755399441055744.0);
+  __m256i ki = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k, magic)), _mm256_castpd_si256(magic));
+  __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(ki, _mm256_set1_epi64x(1023)), 52);
+  __m256d y = _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+  /* Overflow and underflow */
+  y = _mm256_blendv_pd(y, _mm256_set1_pd(INFINITY), _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MAX), _CMP_GT_OQ));
+  y = _mm256_blendv_pd(y, _mm256_setzero_pd(), _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MIN), _CMP_LT_OQ));
+  /* max and min dropped NaN: it is put back */
+  y = _mm256_blendv_pd(y, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+  return y;
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d log_avx2(__m256d x)
+{
+  __m256i bits = _mm256_castpd_si256(x);
+  __m256i e = _mm256_sub_epi64(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(1023));
+  __m256i mbits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                  _mm256_set1_epi64x(0x3FF0000000000000LL));
+  __m256d m = _mm256_castsi256_pd(mbits);
+  /* m in [1,2[ : if m > sqrt(2), m = m/2 and e = e+1 */
+  __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+  m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+  e = _mm256_sub_epi64(e, _mm256_castpd_si256(big)); /* big is -1 (all bits set) when true */
+  __m256d magic = _mm256_set1_pd(6755399441055744.0);
+  __m256d ed = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(e, _mm256_castpd_si256(magic))), magic);
+
+  __m256d f = _mm256_div_pd(_mm256_sub_pd(m, _mm256_set1_pd(1.0)), _mm256_add_pd(m, _mm256_set1_pd(1.0)));
+  __m256d f2 = _mm256_mul_pd(f, f);
+  __m256d s = _mm256_set1_pd(1.0/(2*LOG_TERMS-1));
+  for (int i = LOG_TERMS-2; i >= 0; i--)
+  {
+    s = _mm256_fmadd_pd(s, f2, _mm256_set1_pd(1.0/(2*i+1)));
+  }
+  __m256d logm = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), f), s);
+  __m256d y = _mm256_fmadd_pd(ed, _mm256_set1_pd(EXP_LN2_HI), _mm256_fmadd_pd(ed, _mm256_set1_pd(EXP_LN2_LO), logm));
+  /* log(0) = -inf, log(x<0) = NaN, log(inf) = inf */
+  y = _mm256_blendv_pd(y, _mm256_set1_pd(-INFINITY), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_EQ_OQ));
+  y = _mm256_blendv_pd(y, _mm256_set1_pd(NAN), _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NGE_UQ));
+  y = _mm256_blendv_pd(y, x, _mm256_cmp_pd(x, _mm256_set1_pd(INFINITY), _CMP_EQ_OQ));
+  return y;
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d PHI_avx2(__m256d x)
+{
+  __m256d u = _mm256_mul_pd(_mm256_add_pd(x, _mm256_set1_pd(PHI_TABLE_MAX)), _mm256_set1_pd(PHI_TABLE_STEPS));
+  u = _mm256_max_pd(u, _mm256_setzero_pd());
+  u = _mm256_min_pd(u, _mm256_set1_pd(PHI_TABLE_SIZE - 1e-9));
+  __m256d fl = _mm256_floor_pd(u);
+  __m256d t = _mm256_sub_pd(u, fl);
+  __m128i idx = _mm_mullo_epi32(_mm256_cvttpd_epi32(fl), _mm_set1_epi32(6));
+  double* base = &phiTable[0][0];
+  __m256d p = _mm256_i32gather_pd(base + 5, idx, 8);
+  for (int c = 4; c >= 0; c--)
+  {
+    p = _mm256_fmadd_pd(p, t, _mm256_i32gather_pd(base + c, idx, 8));
+  }
+  p = _mm256_blendv_pd(p, _mm256_setzero_pd(), _mm256_cmp_pd(x, _mm256_set1_pd(-PHI_TABLE_MAX), _CMP_LE_OQ));
+  p = _mm256_blendv_pd(p, _mm256_set1_pd(1.0), _mm256_cmp_pd(x, _mm256_set1_pd(PHI_TABLE_MAX), _CMP_GE_OQ));
+  /* A NaN lane read the entry 0 of the table (max and min dropped NaN): NaN as tablePHI */
+  p = _mm256_blendv_pd(p, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+  return p;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t vecExp_avx2(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm256_storeu_pd(y + i, exp_avx2(_mm256_loadu_pd(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t vecLog_avx2(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm256_storeu_pd(y + i, log_avx2(_mm256_loadu_pd(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t vecPHI_avx2(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    _mm256_storeu_pd(y + i, PHI_avx2(_mm256_loadu_pd(x + i)));
+  }
+  return i;
+}
+
+/* ==========================================================*/
+/* AVX-512 versions (8 doubles)                               */
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512d exp_avx512(__m512d x)
+{
+  __m512d xc = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_MIN)), _mm512_set1_pd(EXP_MAX));
+  __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(xc, _mm512_set1_pd(1.4426950408889634)),
+                                   _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_HI), xc);
+  r = _mm512_fnmadd_pd(k, _mm512_set1_pd(EXP_LN2_LO), r);
+  __m512d p = _mm512_set1_pd(expCoeffs[13]);
+  for (int i = 12; i >= 0; i--)
+  {
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(expCoeffs[i]));
+  }
+  __m512d y = _mm512_scalef_pd(p, k);
+  y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_MAX), _CMP_GT_OQ), y, _mm512_set1_pd(INFINITY));
+  y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_MIN), _CMP_LT_OQ), y, _mm512_setzero_pd());
+  y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q), y, x);
+  return y;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512d log_avx512(__m512d x)
+{
+  /* x = m * 2^e with m in [1,2[ */
+  __m512d e = _mm512_getexp_pd(x);
+  __m512d m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+  __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+  m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+  e = _mm512_mask_add_pd(e, big, e, _mm512_set1_pd(1.0));
+
+  __m512d f = _mm512_div_pd(_mm512_sub_pd(m, _mm512_set1_pd(1.0)), _mm512_add_pd(m, _mm512_set1_pd(1.0)));
+  __m512d f2 = _mm512_mul_pd(f, f);
+  __m512d s = _mm512_set1_pd(1.0/(2*LOG_TERMS-1));
+  for (int i = LOG_TERMS-2; i >= 0; i--)
+  {
+    s = _mm512_fmadd_pd(s, f2, _mm512_set1_pd(1.0/(2*i+1)));
+  }
+  __m512d logm = _mm512_mul_pd(_mm512_mul_pd(_mm512_set1_pd(2.0), f), s);
+  __m512d y = _mm512_fmadd_pd(e, _mm512_set1_pd(EXP_LN2_HI), _mm512_fmadd_pd(e, _mm512_set1_pd(EXP_LN2_LO), logm));
+  y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_EQ_OQ), y, _mm512_set1_pd(-INFINITY));
+  y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_NGE_UQ), y, _mm512_set1_pd(NAN));
+  y = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(INFINITY), _CMP_EQ_OQ), y, x);
+  return y;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512d PHI_avx512(__m512d x)
+{
+  __m512d u = _mm512_mul_pd(_mm512_add_pd(x, _mm512_set1_pd(PHI_TABLE_MAX)), _mm512_set1_pd(PHI_TABLE_STEPS));
+  u = _mm512_max_pd(u, _mm512_setzero_pd());
+  u = _mm512_min_pd(u, _mm512_set1_pd(PHI_TABLE_SIZE - 1e-9));
+  __m512d fl = _mm512_roundscale_pd(u, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  __m512d t = _mm512_sub_pd(u, fl);
+  __m256i idx = _mm256_mullo_epi32(_mm512_cvttpd_epi32(fl), _mm256_set1_epi32(6));
+  double* base = &phiTable[0][0];
+  __m512d p = _mm512_i32gather_pd(idx, base + 5, 8);
+  for (int c = 4; c >= 0; c--)
+  {
+    p = _mm512_fmadd_pd(p, t, _mm512_i32gather_pd(idx, base + c, 8));
+  }
+  p = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(-PHI_TABLE_MAX), _CMP_LE_OQ), p, _mm512_setzero_pd());
+  p = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(PHI_TABLE_MAX), _CMP_GE_OQ), p, _mm512_set1_pd(1.0));
+  p = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q), p, x);
+  return p;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static size_t vecExp_avx512(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm512_storeu_pd(y + i, exp_avx512(_mm512_loadu_pd(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static size_t vecLog_avx512(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm512_storeu_pd(y + i, log_avx512(_mm512_loadu_pd(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static size_t vecPHI_avx512(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm512_storeu_pd(y + i, PHI_avx512(_mm512_loadu_pd(x + i)));
+  }
+  return i;
+}
+
+/* ==========================================================*/
+/* AVX2 versions (8 floats)                                   */
+
+__attribute__((target("avx2,fma")))
+static inline __m256 expf_avx2(__m256 x)
+{
+  __m256 xc = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(EXPF_MIN)), _mm256_set1_ps(EXPF_MAX));
+  __m256 k = _mm256_round_ps(_mm256_mul_ps(xc, _mm256_set1_ps(1.44269504f)),
+                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps(LN2F_HI), xc);
+  r = _mm256_fnmadd_ps(k, _mm256_set1_ps(LN2F_LO), r);
+  __m256 p = _mm256_set1_ps(expfCoeffs[7]);
+  for (int i = 6; i >= 0; i--)
+  {
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expfCoeffs[i]));
+  }
+  __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23);
+  __m256 y = _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+  y = _mm256_blendv_ps(y, _mm256_set1_ps(INFINITY), _mm256_cmp_ps(x, _mm256_set1_ps(EXPF_MAX), _CMP_GT_OQ));
+  y = _mm256_blendv_ps(y, _mm256_setzero_ps(), _mm256_cmp_ps(x, _mm256_set1_ps(EXPF_MIN), _CMP_LT_OQ));
+  y = _mm256_blendv_ps(y, x, _mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+  return y;
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 logf_avx2(__m256 x)
+{
+  __m256i bits = _mm256_castps_si256(x);
+  __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+  __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                                                 _mm256_set1_epi32(0x3F800000)));
+  __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+  m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+  e = _mm256_sub_epi32(e, _mm256_castps_si256(big));
+  __m256 ef = _mm256_cvtepi32_ps(e);
+
+  __m256 f = _mm256_div_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.0f)), _mm256_add_ps(m, _mm256_set1_ps(1.0f)));
+  __m256 f2 = _mm256_mul_ps(f, f);
+  __m256 s = _mm256_set1_ps(1.0f/(2*LOGF_TERMS-1));
+  for (int i = LOGF_TERMS-2; i >= 0; i--)
+  {
+    s = _mm256_fmadd_ps(s, f2, _mm256_set1_ps(1.0f/(2*i+1)));
+  }
+  __m256 logm = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), f), s);
+  __m256 y = _mm256_fmadd_ps(ef, _mm256_set1_ps(LN2F_HI), _mm256_fmadd_ps(ef, _mm256_set1_ps(LN2F_LO), logm));
+  y = _mm256_blendv_ps(y, _mm256_set1_ps(-INFINITY), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_EQ_OQ));
+  y = _mm256_blendv_ps(y, _mm256_set1_ps(NAN), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NGE_UQ));
+  y = _mm256_blendv_ps(y, x, _mm256_cmp_ps(x, _mm256_set1_ps(INFINITY), _CMP_EQ_OQ));
+  return y;
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 PHIf_avx2(__m256 x)
+{
+  __m256 z = _mm256_mul_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), x), _mm256_set1_ps(0.707106781f));
+  __m256 t = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_fmadd_ps(_mm256_set1_ps(ERFC_P), z, _mm256_set1_ps(1.0f)));
+  __m256 p = _mm256_set1_ps(erfcCoeffs[4]);
+  for (int i = 3; i >= 0; i--)
+  {
+    p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(erfcCoeffs[i]));
+  }
+  __m256 e = expf_avx2(_mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), z), z));
+  __m256 half = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), t), _mm256_mul_ps(p, e));
+  return _mm256_blendv_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), half), half,
+                          _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+}
+
+__attribute__((target("avx2,fma")))
+static size_t vecExpf_avx2(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm256_storeu_ps(y + i, expf_avx2(_mm256_loadu_ps(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t vecLogf_avx2(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm256_storeu_ps(y + i, logf_avx2(_mm256_loadu_ps(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx2,fma")))
+static size_t vecPHIf_avx2(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    _mm256_storeu_ps(y + i, PHIf_avx2(_mm256_loadu_ps(x + i)));
+  }
+  return i;
+}
+
+/* ==========================================================*/
+/* AVX-512 versions (16 floats)                               */
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512 expf_avx512(__m512 x)
+{
+  __m512 xc = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(EXPF_MIN)), _mm512_set1_ps(EXPF_MAX));
+  __m512 k = _mm512_roundscale_ps(_mm512_mul_ps(xc, _mm512_set1_ps(1.44269504f)),
+                                  _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512 r = _mm512_fnmadd_ps(k, _mm512_set1_ps(LN2F_HI), xc);
+  r = _mm512_fnmadd_ps(k, _mm512_set1_ps(LN2F_LO), r);
+  __m512 p = _mm512_set1_ps(expfCoeffs[7]);
+  for (int i = 6; i >= 0; i--)
+  {
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expfCoeffs[i]));
+  }
+  __m512 y = _mm512_scalef_ps(p, k);
+  y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(EXPF_MAX), _CMP_GT_OQ), y, _mm512_set1_ps(INFINITY));
+  y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(EXPF_MIN), _CMP_LT_OQ), y, _mm512_setzero_ps());
+  y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), y, x);
+  return y;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512 logf_avx512(__m512 x)
+{
+  __m512 e = _mm512_getexp_ps(x);
+  __m512 m = _mm512_getmant_ps(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_zero);
+  __mmask16 big = _mm512_cmp_ps_mask(m, _mm512_set1_ps(1.41421356f), _CMP_GT_OQ);
+  m = _mm512_mask_mul_ps(m, big, m, _mm512_set1_ps(0.5f));
+  e = _mm512_mask_add_ps(e, big, e, _mm512_set1_ps(1.0f));
+
+  __m512 f = _mm512_div_ps(_mm512_sub_ps(m, _mm512_set1_ps(1.0f)), _mm512_add_ps(m, _mm512_set1_ps(1.0f)));
+  __m512 f2 = _mm512_mul_ps(f, f);
+  __m512 s = _mm512_set1_ps(1.0f/(2*LOGF_TERMS-1));
+  for (int i = LOGF_TERMS-2; i >= 0; i--)
+  {
+    s = _mm512_fmadd_ps(s, f2, _mm512_set1_ps(1.0f/(2*i+1)));
+  }
+  __m512 logm = _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(2.0f), f), s);
+  __m512 y = _mm512_fmadd_ps(e, _mm512_set1_ps(LN2F_HI), _mm512_fmadd_ps(e, _mm512_set1_ps(LN2F_LO), logm));
+  y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_EQ_OQ), y, _mm512_set1_ps(-INFINITY));
+  y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_NGE_UQ), y, _mm512_set1_ps(NAN));
+  y = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_set1_ps(INFINITY), _CMP_EQ_OQ), y, x);
+  return y;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512 PHIf_avx512(__m512 x)
+{
+  __m512 z = _mm512_mul_ps(_mm512_abs_ps(x), _mm512_set1_ps(0.707106781f));
+  __m512 t = _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_fmadd_ps(_mm512_set1_ps(ERFC_P), z, _mm512_set1_ps(1.0f)));
+  __m512 p = _mm512_set1_ps(erfcCoeffs[4]);
+  for (int i = 3; i >= 0; i--)
+  {
+    p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(erfcCoeffs[i]));
+  }
+  __m512 e = expf_avx512(_mm512_mul_ps(_mm512_sub_ps(_mm512_setzero_ps(), z), z));
+  __m512 half = _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), t), _mm512_mul_ps(p, e));
+  return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ),
+                              _mm512_sub_ps(_mm512_set1_ps(1.0f), half), half);
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static size_t vecExpf_avx512(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    _mm512_storeu_ps(y + i, expf_avx512(_mm512_loadu_ps(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static size_t vecLogf_avx512(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    _mm512_storeu_ps(y + i, logf_avx512(_mm512_loadu_ps(x + i)));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static size_t vecPHIf_avx512(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16)
+  {
+    _mm512_storeu_ps(y + i, PHIf_avx512(_mm512_loadu_ps(x + i)));
+  }
+  return i;
+}
+
+/* ==========================================================*/
+/* Array functions: vector loop, then the remaining values    */
+/* with the scalar version                                    */
+
+void vecExp(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  switch (getVecISA())
+  {
+    case VEC_AVX512: i = vecExp_avx512(x, y, n); break;
+    case VEC_AVX2:   i = vecExp_avx2(x, y, n);   break;
+    default: break;
+  }
+  for (; i < n; i++)
+  {
+    y[i] = exp(x[i]);
+  }
+}
+
+void vecLog(double* x, double* y, size_t n)
+{
+  size_t i = 0;
+  switch (getVecISA())
+  {
+    case VEC_AVX512: i = vecLog_avx512(x, y, n); break;
+    case VEC_AVX2:   i = vecLog_avx2(x, y, n);   break;
+    default: break;
+  }
+  for (; i < n; i++)
+  {
+    y[i] = log(x[i]);
+  }
+}
+
+void vecPHI(double* x, double* y, size_t n)
+{
+  initPhiTable();
+  size_t i = 0;
+  switch (getVecISA())
+  {
+    case VEC_AVX512: i = vecPHI_avx512(x, y, n); break;
+    case VEC_AVX2:   i = vecPHI_avx2(x, y, n);   break;
+    default: break;
+  }
+  for (; i < n; i++)
+  {
+    y[i] = tablePHI(x[i]);
+  }
+}
+
+void vecExpf(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  switch (getVecISA())
+  {
+    case VEC_AVX512: i = vecExpf_avx512(x, y, n); break;
+    case VEC_AVX2:   i = vecExpf_avx2(x, y, n);   break;
+    default: break;
+  }
+  for (; i < n; i++)
+  {
+    y[i] = expf(x[i]);
+  }
+}
+
+void vecLogf(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  switch (getVecISA())
+  {
+    case VEC_AVX512: i = vecLogf_avx512(x, y, n); break;
+    case VEC_AVX2:   i = vecLogf_avx2(x, y, n);   break;
+    default: break;
+  }
+  for (; i < n; i++)
+  {
+    y[i] = logf(x[i]);
+  }
+}
+
+void vecPHIf(float* x, float* y, size_t n)
+{
+  size_t i = 0;
+  switch (getVecISA())
+  {
+    case VEC_AVX512: i = vecPHIf_avx512(x, y, n); break;
+    case VEC_AVX2:   i = vecPHIf_avx2(x, y, n);   break;
+    default: break;
+  }
+  for (; i < n; i++)
+  {
+    y[i] = scalarPHIf(x[i]);
+  }
+}
@@ -0,0 +1,57 @@
+/*************************************/
+/* Header file vecmath.h             */
+/* Creation date: 17 October, 2026   */
+/*************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifndef VECMATH_H
+#define VECMATH_H
+
+/* Instruction sets of the vector functions below */
+typedef enum {VEC_SCALAR=0, VEC_AVX2, VEC_AVX512} VecISA;
+
+#ifdef VECMATH_C
+
+#else /* VECMATH_C */
+
+/* Selects the instruction set used by the vector functions.
+   name can be "auto" (the best one supported by the processor, default), "scalar",
+   "avx2" or "avx512". Returns false if the processor does not support it.
+   This changes a global variable: call it before starting threads. */
+extern bool setVecISA(char* name);
+/* The automatic choice is made once (pthread_once) at the first use: the vector functions
+   can be called by several threads without calling setVecISA. */
+extern VecISA getVecISA(void);
+extern char* vecISAName(VecISA isa);
+
+/* y[i] = exp(x[i]), log(x[i]) or PHI(x[i]) for i = 0..n-1 (x and y may be the same array).
+   - vecExp : relative error < 2 ulp (exp of the C library for the scalar version)
+   - vecLog : relative error < 2 ulp for normal x > 0 (log of the C library for the scalar version)
+   - vecPHI : absolute error < 1e-13, interpolation in the table of tablePHI */
+extern void vecExp(double* x, double* y, size_t n);
+extern void vecLog(double* x, double* y, size_t n);
+extern void vecPHI(double* x, double* y, size_t n);
+
+/* Single precision versions (twice as many values per vector instruction), for the float
+   functions of pfa.h and integration.h:
+   - vecExpf : relative error < 2e-7 for x in [-87, 88] (0 below, inf above)
+   - vecLogf : relative error < 2e-7 for normal x > 0
+   - vecPHIf : absolute error < 2e-7, from a rational approximation of erfc (no table) */
+extern void vecExpf(float* x, float* y, size_t n);
+extern void vecLogf(float* x, float* y, size_t n);
+extern void vecPHIf(float* x, float* y, size_t n);
+
+/* Cumulative distribution function of N(0,1), interpolated in a precomputed table.
+   The table is built by the first call (thread-safe). */
+extern double tablePHI(double x);
+extern void initPhiTable(void);
+
+#endif /* VECMATH_C */
+
+#endif /* VECMATH_H */